@@ -0,0 +1,338 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <iomanip>
+#include <numeric>
+#include "../include/Batch.h"
+#include "../include/Ensemble.h"
+#include "../include/GameOfLife.h"
+
+namespace {
+
+const char* USAGE =
+    "Usage: GameOfLife [--load file | --size HxW [--density d] [--seed s]] [--engine type] [--rule r] [--gens n]\n"
+    "                  [--threads n] [--ranks n] [--k n] [--history n] [--tile-size n] [--schedule static|dynamic]\n"
+    "                  [--cl-group XxY[xCells]] [--cl-batch n] [--hashlife-memory MB]\n"
+    "                  [--out file] [--stats file|-] [--trace file]\n"
+    "                  [--checkpoint file [--checkpoint-every n] [--checkpoint-seconds t] [--compress zlib|none]] [--resume file]\n"
+    "       GameOfLife --ensemble n --size HxW [--density d] [--seed s] [--gens n] [--threads n] [--stats file|-]\n"
+    "Without arguments the interactive menu is started.\n";
+
+const std::vector<std::string> ENGINES = {"scalar", "CL", "CL-persistent", "bitpacked", "fused", "omp", "simd", "tiled", "temporal", "hashlife", "sparse", "distributed"};
+
+bool is_pattern(const std::string& path) {
+    auto ends_with = [&path](const std::string& ext) {
+        return path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+    };
+    return ends_with(".rle") || ends_with(".cells");
+}
+
+void write_stats(std::ostream& out, const BatchOptions& options, GameOfLife& gof, size_t initial_population) {
+    int height = gof.get_height(), width = gof.get_width();
+    // One entry of the data can cover several generations (temporal, CL-persistent, hashlife), min/median/max are per generation
+    std::vector<double> samples = gof.get_seconds_per_generation();
+    std::sort(samples.begin(), samples.end());
+    double total = 0.0;
+    for (const auto& duration : gof.get_data()) {
+        total += duration.count();
+    }
+    auto data_generations = gof.get_data_generations();
+    uint64_t timed = std::accumulate(data_generations.begin(), data_generations.end(), (uint64_t)0);
+    uint64_t gens = gof.get_generations_run();
+
+    out << std::setprecision(9);
+    out << "{\n  \"engine\": \"" << gof.get_engine() << "\", \"requested_engine\": \"" << options.engine << "\", \"rule\": \"" << gof.get_rule() << "\",\n"
+        << "  \"height\": " << height << ", \"width\": " << width << ", \"threads\": " << omp_get_max_threads() << ",\n";
+    out << "  \"topology\": \"" << gof.get_topology() << "\"";
+    if (gof.get_topology() == "plane") {
+        out << ", \"reached_edge\": " << (gof.reached_plane_edge() ? "true" : "false");
+    }
+    out << ",\n";
+    if (gof.get_engine() == "CL" || gof.get_engine() == "CL-persistent") {
+        out << "  \"cl_group\": \"" << gof.get_cl_group() << "\",\n";
+    }
+    if (gof.get_engine() == "hashlife") {
+        out << "  \"hashlife_peak_bytes\": " << gof.get_hashlife_peak_memory() << ",\n";
+    }
+    out << "  \"generations_requested\": " << options.gens << ", \"generations_run\": " << gens
+        << ", \"generation\": " << gof.get_generation() << ", \"stable\": " << (gof.is_stopped_stable() ? "true" : "false") << ",\n"
+        << "  \"population_initial\": " << initial_population << ", \"population_final\": " << gof.get_population() << ",\n"
+        << "  \"samples\": " << samples.size() << ", \"samples_generations\": " << timed << ", \"total_s\": " << total;
+    if (!samples.empty()) {
+        out << ", \"min_s\": " << samples.front() << ", \"median_s\": " << samples[samples.size() / 2]
+            << ", \"max_s\": " << samples.back();
+    }
+    out << ",\n  \"cells_per_second\": " << (total > 0 ? (double)height * width * timed / total : 0.0) << "\n}\n";
+}
+
+// Totals first, then one compact array per statistic with an entry per world
+void write_ensemble_stats(std::ostream& out, const BatchOptions& options, const Ensemble& ensemble, double seconds) {
+    const std::vector<EnsembleStats>& stats = ensemble.get_stats();
+    uint64_t gens = 0;
+    size_t stable = 0;
+    for (const EnsembleStats& s : stats) {
+        gens += s.generations;
+        stable += s.stable;
+    }
+    auto array = [&](const char* name, auto field) {
+        out << "  \"" << name << "\": [";
+        for (size_t k = 0; k < stats.size(); ++k) {
+            out << (k ? "," : "") << (unsigned)field(stats[k]);
+        }
+        out << "]";
+    };
+
+    out << std::setprecision(9);
+    out << "{\n  \"engine\": \"ensemble\", \"worlds\": " << stats.size() << ", \"height\": " << options.height
+        << ", \"width\": " << options.width << ", \"threads\": " << omp_get_max_threads() << ",\n"
+        << "  \"generations_requested\": " << options.gens << ", \"generations_run\": " << gens << ", \"stable\": " << stable
+        << ", \"total_s\": " << seconds << ",\n  \"cells_per_second\": "
+        << (seconds > 0 ? (double)options.height * options.width * gens / seconds : 0.0) << ",\n";
+    array("generations", [](const EnsembleStats& s) {return s.generations;});
+    out << ",\n";
+    array("population_initial", [](const EnsembleStats& s) {return s.initial_population;});
+    out << ",\n";
+    array("population_final", [](const EnsembleStats& s) {return s.population;});
+    out << ",\n";
+    array("period", [](const EnsembleStats& s) {return s.period;});
+    out << "\n}\n";
+}
+
+int run_ensemble(const BatchOptions& options) {
+    Ensemble ensemble(options.ensemble, options.height, options.width);
+    ensemble.randomize(options.seed, options.density >= 0 ? options.density : 0.5);
+
+    auto start = std::chrono::steady_clock::now();
+    ensemble.run(options.gens);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (options.stats == "-") {
+        write_ensemble_stats(std::cout, options, ensemble, seconds);
+    } else if (!options.stats.empty()) {
+        std::ofstream file(options.stats);
+        if (!file.is_open()) {
+            std::cerr << "Error: Failed to open file for writing: " << options.stats << std::endl;
+            return 1;
+        }
+        write_ensemble_stats(file, options, ensemble, seconds);
+    }
+    return 0;
+}
+
+} // namespace
+
+bool parse_batch_args(int argc, char** argv, BatchOptions& options, std::string& error) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            error = "Missing value for " + arg;
+            return false;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--load") {
+                options.load = value;
+            } else if (arg == "--size") {
+                size_t x = value.find_first_of("xX,");
+                if (x == std::string::npos) {
+                    error = "--size expects HxW";
+                    return false;
+                }
+                options.height = std::stoi(value.substr(0, x));
+                options.width = std::stoi(value.substr(x + 1));
+            } else if (arg == "--density") {
+                options.density = std::stod(value);
+            } else if (arg == "--seed") {
+                options.seed = std::stoull(value);
+            } else if (arg == "--engine") {
+                options.engine = value;
+            } else if (arg == "--rule") {
+                parse_rule(value); // Fails here with the reason instead of in the middle of the run
+                options.rule = value;
+            } else if (arg == "--gens") {
+                options.gens = std::stoi(value);
+            } else if (arg == "--threads") {
+                options.threads = std::stoi(value);
+            } else if (arg == "--ranks") {
+                options.ranks = std::stoi(value);
+            } else if (arg == "--k") {
+                options.k = std::stoi(value);
+            } else if (arg == "--history") {
+                options.history = std::stoul(value);
+            } else if (arg == "--tile-size") {
+                options.tile_size = std::stoi(value);
+            } else if (arg == "--cl-group") {
+                // XxY or XxYxCells, the cells per work-item stay 4 when they are left out
+                size_t first = value.find_first_of("xX"), second = value.find_first_of("xX", first + 1);
+                if (first == std::string::npos) {
+                    error = "--cl-group expects XxY or XxYxCells";
+                    return false;
+                }
+                options.cl_group[0] = std::stoi(value.substr(0, first));
+                options.cl_group[1] = std::stoi(value.substr(first + 1, second - first - 1));
+                if (second != std::string::npos) {
+                    options.cl_group[2] = std::stoi(value.substr(second + 1));
+                }
+            } else if (arg == "--cl-batch") {
+                options.cl_batch = std::stoi(value);
+            } else if (arg == "--hashlife-memory") {
+                options.hashlife_memory = std::stoul(value);
+            } else if (arg == "--schedule") {
+                options.schedule = value;
+            } else if (arg == "--out") {
+                options.out = value;
+            } else if (arg == "--stats") {
+                options.stats = value;
+            } else if (arg == "--trace") {
+                options.trace = value;
+            } else if (arg == "--ensemble") {
+                options.ensemble = std::stoul(value);
+            } else if (arg == "--checkpoint") {
+                options.checkpoint = value;
+            } else if (arg == "--checkpoint-every") {
+                options.checkpoint_every = std::stoi(value);
+            } else if (arg == "--checkpoint-seconds") {
+                options.checkpoint_seconds = std::stod(value);
+            } else if (arg == "--compress") {
+                if (value != "zlib" && value != "none") {
+                    error = "--compress expects zlib or none";
+                    return false;
+                }
+                options.compress = value == "zlib";
+            } else if (arg == "--resume") {
+                options.resume = value;
+            } else {
+                error = "Unknown argument " + arg;
+                return false;
+            }
+        } catch (const std::invalid_argument& e) {
+            error = arg == "--rule" ? e.what() : "Invalid value for " + arg + ": " + value;
+            return false;
+        } catch (const std::logic_error&) {
+            error = "Invalid value for " + arg + ": " + value;
+            return false;
+        }
+    }
+
+    if (std::find(ENGINES.begin(), ENGINES.end(), options.engine) == ENGINES.end()) {
+        error = "Unknown engine " + options.engine;
+        return false;
+    }
+    bool sized = options.height > 0 && options.width > 0;
+    if (options.ensemble > 0 && (!options.load.empty() || !sized || !parse_rule(options.rule).is_life())) {
+        error = "--ensemble needs --size, random B3/S23 worlds only";
+        return false;
+    }
+    if (options.load.empty() && !sized) {
+        error = "Either --load or --size is needed";
+        return false;
+    }
+    if (!options.load.empty() && is_pattern(options.load) && !sized) {
+        error = "Patterns need the world size (--size)";
+        return false;
+    }
+    if (options.checkpoint_every < 0 || options.checkpoint_seconds < 0) {
+        error = "--checkpoint-every and --checkpoint-seconds must not be negative";
+        return false;
+    }
+    if (options.compress && !checkpoint_compression_available()) {
+        error = "--compress zlib is not available, this build has no zlib";
+        return false;
+    }
+    bool group = options.cl_group[0] > 0 && options.cl_group[1] > 0 && options.cl_group[2] > 0;
+    if (options.gens < 0 || options.threads < 0 || options.tile_size <= 0 || options.ranks <= 0 || options.k <= 0 || !group || options.cl_batch <= 0) {
+        error = "--gens and --threads must not be negative, --ranks, --k, --tile-size, --cl-group and --cl-batch must be positive";
+        return false;
+    }
+    return true;
+}
+
+int run_batch(const BatchOptions& options) {
+    if (options.threads > 0) {
+        omp_set_num_threads(options.threads);
+    }
+    if (!options.trace.empty()) {
+        Profiler::get().enable(true);
+    }
+    if (options.ensemble > 0) {
+        return run_ensemble(options);
+    }
+
+    try {
+        std::unique_ptr<GameOfLife> gof;
+        // The same command line starts the run and continues it after a crash
+        bool resumed = !options.resume.empty() && is_checkpoint(options.resume);
+        if (resumed) {
+            gof = std::make_unique<GameOfLife>(options.resume);
+            std::cerr << "Resuming " << options.resume << " at generation " << gof->get_generation() << std::endl;
+        } else if (!options.load.empty() && !is_pattern(options.load)) {
+            gof = std::make_unique<GameOfLife>(options.load);
+        } else {
+            gof = std::make_unique<GameOfLife>(options.height, options.width);
+            if (options.density >= 0) {
+                // Same seeding as the benchmark, equal seeds give equal worlds for any --threads
+                gof->set_seed(options.seed);
+                gof->simple_randomize(options.density);
+            }
+            if (!options.load.empty()) {
+                gof->load_pattern(options.load, 0, 0);
+            }
+        }
+
+        gof->set_headless(true);
+        gof->set_rule(options.rule);
+        gof->set_history_depth(options.history);
+        gof->set_tile_size(options.tile_size);
+        gof->set_ranks(options.ranks);
+        gof->set_temporal(options.k);
+        gof->set_schedule(options.schedule);
+        gof->set_cl_group(options.cl_group[0], options.cl_group[1], options.cl_group[2]);
+        gof->set_cl_batch(options.cl_batch);
+        gof->set_hashlife_memory(options.hashlife_memory);
+        gof->set_checkpoints(options.checkpoint, options.checkpoint_every, options.checkpoint_seconds, options.compress);
+        size_t initial_population = gof->get_population();
+        int gens = resumed ? (int)std::max<int64_t>(0, options.gens - (int64_t)gof->get_generation()) : options.gens;
+
+        // Messages of the simulation go to stderr, stdout stays free for the statistics
+        std::streambuf* console = std::cout.rdbuf(std::cerr.rdbuf());
+        gof->run_simulation(gens, options.engine);
+        std::cout.rdbuf(console);
+
+        if (!options.out.empty()) {
+            gof->save_world(options.out);
+        }
+
+        if (options.stats == "-") {
+            write_stats(std::cout, options, *gof, initial_population);
+        } else if (!options.stats.empty()) {
+            std::ofstream file(options.stats);
+            if (!file.is_open()) {
+                throw std::runtime_error("Failed to open file for writing: " + options.stats);
+            }
+            write_stats(file, options, *gof, initial_population);
+        }
+
+        if (!options.trace.empty() && !gof->save_trace(options.trace)) {
+            throw std::runtime_error("Failed to open file for writing: " + options.trace);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int run_batch(int argc, char** argv) {
+    BatchOptions options;
+    std::string error;
+    if (argc == 2 && (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h")) {
+        std::cout << USAGE;
+        return 0;
+    }
+    if (!parse_batch_args(argc, argv, options, error)) {
+        std::cerr << error << std::endl << USAGE;
+        return 2;
+    }
+    return run_batch(options);
+}
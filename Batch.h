@@ -0,0 +1,43 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstdint>
+#include <string>
+
+struct BatchOptions {
+    std::string load;           // World (.txt/.bin) or pattern (.rle/.cells) to start from
+    int height = 0, width = 0;  // Size of a new world when nothing (or only a pattern) is loaded
+    double density = -1.0;      // Seeds the new world with this fraction of live cells
+    uint64_t seed = 42;
+    std::string engine = "scalar";
+    std::string rule = "B3/S23";
+    int gens = 100;
+    int threads = 0;            // 0 keeps the OpenMP default
+    int ranks = 4;              // Processes of the "distributed" engine
+    int k = 8;                  // Generations per pass of the "temporal" engine
+    size_t history = 3;
+    int tile_size = 64;
+    size_t hashlife_memory = 1024; // MB of the node cache of "hashlife" before it is collected
+    int cl_group[3] = {32, 8, 4};  // Work-group of the CL evolve kernel: x, y and cells per work-item
+    int cl_batch = 16;          // Generations "CL-persistent" queues before it reads the stability flags
+    std::string schedule = "static";
+    std::string out;            // Final world, the format comes from the extension
+    std::string stats;          // JSON summary of the run, "-" writes it to stdout
+    std::string trace;          // Chrome trace of the phases, turns the profiler on
+    size_t ensemble = 0;        // Runs this many random worlds of --size together (Ensemble) instead of one
+    std::string checkpoint;     // Written in the background every checkpoint_every generations or seconds and at the end
+    int checkpoint_every = 0;
+    double checkpoint_seconds = 0;
+    bool compress = false;      // zlib for the checkpoints
+    std::string resume;         // Continues from this checkpoint up to --gens when it exists
+};
+
+/*
++ Headless entry point for scripts and batch jobs: no menus, no pauses and no terminal escapes.
++ Returns 0 on success, 1 when the run failed (I/O, OpenCL) and 2 for invalid arguments.
+*/
+int run_batch(int argc, char** argv);
+bool parse_batch_args(int argc, char** argv, BatchOptions& options, std::string& error);
+int run_batch(const BatchOptions& options);
+
+#endif //BATCH_H
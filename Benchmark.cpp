@@ -0,0 +1,121 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <algorithm>
+#include <iomanip>
+#include "../include/Benchmark.h"
+#include "../include/GameOfLife.h"
+
+namespace {
+
+// Every repetition starts from the same world, so the engines are compared on identical work
+void seed_world(GameOfLife& gof, double density, uint64_t seed) {
+    gof.set_seed(seed);
+    gof.simple_randomize(density);
+}
+
+// State bytes one generation reads and writes per cell (present in, future out)
+double bytes_per_cell(const std::string& engine) {
+    if (engine == "bitpacked") {
+        return 2.0 / 8.0;
+    }
+    if (engine == "hashlife") {
+        return 0.0; // Depends on the node cache, not on the area
+    }
+    return 2.0;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    // Nearest rank
+    size_t rank = (size_t)std::ceil(p * sorted.size());
+    return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+}
+
+} // namespace
+
+std::vector<BenchmarkResult> run_benchmark(const BenchmarkConfig& config, std::ostream& log) {
+    std::vector<BenchmarkResult> results;
+
+    for (int size : config.sizes) {
+        for (double density : config.densities) {
+            for (const std::string& engine : config.engines) {
+                // One sample per entry of the data, divided by the generations the entry covers
+                std::vector<double> samples;
+                double seconds = 0.0;
+                uint64_t generations = 0;
+
+                for (int run = 0; run < config.warmup + config.repetitions; ++run) {
+                    GameOfLife gof(size, size);
+                    seed_world(gof, density, config.seed);
+                    // The messages of the simulation would end up between the results
+                    std::streambuf* console = std::cout.rdbuf(nullptr);
+                    gof.run_simulation(config.generations, engine);
+                    std::cout.rdbuf(console);
+                    std::cout.clear();
+                    if (run < config.warmup) {
+                        continue;
+                    }
+                    std::vector<double> per_generation = gof.get_seconds_per_generation();
+                    samples.insert(samples.end(), per_generation.begin(), per_generation.end());
+                    for (const auto& duration : gof.get_data()) {
+                        seconds += duration.count();
+                    }
+                    for (uint32_t g : gof.get_data_generations()) {
+                        generations += g;
+                    }
+                }
+                if (samples.empty()) {
+                    continue;
+                }
+
+                std::sort(samples.begin(), samples.end());
+                BenchmarkResult r;
+                r.engine = engine;
+                r.size = size;
+                r.density = density;
+                r.samples = samples.size();
+                r.generations = generations;
+                r.min = samples.front();
+                r.median = percentile(samples, 0.5);
+                r.p95 = percentile(samples, 0.95);
+                r.p99 = percentile(samples, 0.99);
+                r.mean = generations ? seconds / generations : 0.0;
+                double cells = (double)size * size;
+                r.cells_per_second = r.mean > 0 ? cells / r.mean : 0.0;
+                r.bytes_per_second = r.cells_per_second * bytes_per_cell(engine);
+                results.push_back(r);
+
+                log << std::left << std::setw(14) << engine << " size " << std::setw(6) << size
+                    << " density " << std::setw(5) << density << " median " << r.median * 1e3 << " ms"
+                    << " p99 " << r.p99 * 1e3 << " ms " << r.cells_per_second / 1e6 << " Mcells/s" << std::endl;
+            }
+        }
+    }
+    return results;
+}
+
+void write_benchmark_json(std::ostream& out, const BenchmarkConfig& config, const std::vector<BenchmarkResult>& results) {
+    out << std::setprecision(9);
+    out << "{\n  \"config\": {\"generations\": " << config.generations << ", \"warmup\": " << config.warmup
+        << ", \"repetitions\": " << config.repetitions << ", \"seed\": " << config.seed << "},\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& r = results[i];
+        out << "    {\"engine\": \"" << r.engine << "\", \"size\": " << r.size << ", \"density\": " << r.density
+            << ", \"samples\": " << r.samples << ", \"generations\": " << r.generations << ", \"min_s\": " << r.min << ", \"median_s\": " << r.median
+            << ", \"p95_s\": " << r.p95 << ", \"p99_s\": " << r.p99 << ", \"mean_s\": " << r.mean
+            << ", \"cells_per_second\": " << r.cells_per_second << ", \"bytes_per_second\": " << r.bytes_per_second << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+void write_benchmark_csv(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+    out << std::setprecision(9);
+    out << "engine,size,density,samples,generations,min_s,median_s,p95_s,p99_s,mean_s,cells_per_second,bytes_per_second\n";
+    for (const BenchmarkResult& r : results) {
+        out << r.engine << "," << r.size << "," << r.density << "," << r.samples << "," << r.generations << "," << r.min << "," << r.median
+            << "," << r.p95 << "," << r.p99 << "," << r.mean << "," << r.cells_per_second << "," << r.bytes_per_second << "\n";
+    }
+}
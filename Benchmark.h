@@ -0,0 +1,36 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct BenchmarkConfig {
+    std::vector<std::string> engines = {"scalar", "fused", "omp", "simd", "bitpacked", "tiled"};
+    std::vector<int> sizes = {100, 1000};  // Square worlds of size x size
+    std::vector<double> densities = {0.3}; // Fraction of live cells in the random start world
+    int generations = 100;
+    int warmup = 1;       // Runs that are not measured
+    int repetitions = 5;  // Measured runs, each starts from the same world
+    uint64_t seed = 42;
+};
+
+struct BenchmarkResult {
+    std::string engine;
+    int size;
+    double density;
+    size_t samples;  // Measured entries of get_data() over all repetitions
+    uint64_t generations; // Generations they cover, more than samples for hashlife, temporal and CL-persistent
+    double min, median, p95, p99; // Seconds per generation of the entries
+    double mean; // Seconds per generation over all of them
+    double cells_per_second;
+    double bytes_per_second; // Bytes of world state read and written per second (estimate)
+};
+
+// Runs every engine on every size/density combination, the progress is written to log
+std::vector<BenchmarkResult> run_benchmark(const BenchmarkConfig& config, std::ostream& log);
+void write_benchmark_json(std::ostream& out, const BenchmarkConfig& config, const std::vector<BenchmarkResult>& results);
+void write_benchmark_csv(std::ostream& out, const std::vector<BenchmarkResult>& results);
+
+#endif //BENCHMARK_H
@@ -0,0 +1,143 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <algorithm>
+#include "../include/BitBoard.h"
+
+namespace {
+
+// -msse has no popcnt instruction, __builtin_popcountll would be a library call
+inline size_t count_bits(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (x * 0x0101010101010101ULL) >> 56;
+}
+
+// Bits set in 8 words, the words are first added bit by bit with carry save adders (the same full adders as
+// evolve_row) into a 1s, 2s, 4s and 8s word, so only 4 counts are needed instead of 8
+inline size_t count_bits8(const uint64_t* w) {
+    auto csa = [](uint64_t a, uint64_t b, uint64_t c, uint64_t& sum) {
+        uint64_t u = a ^ b;
+        sum = u ^ c;
+        return (a & b) | (u & c);
+    };
+    uint64_t ones, twos_a, twos_b, twos, fours_a, fours_b, fours;
+    twos_a = csa(w[0], w[1], w[2], ones);
+    twos_b = csa(ones, w[3], w[4], ones);
+    fours_a = csa(twos_a, twos_b, 0, twos);
+    twos_a = csa(ones, w[5], w[6], ones);
+    twos_b = csa(ones, w[7], 0, ones);
+    fours_b = csa(twos, twos_a, twos_b, twos);
+    uint64_t eights = csa(fours_a, fours_b, 0, fours);
+    return 8 * count_bits(eights) + 4 * count_bits(fours) + 2 * count_bits(twos) + count_bits(ones);
+}
+
+} // namespace
+
+BitBoard::BitBoard(int h, int w) : width(w), height(h) {
+    words_per_row = (width + 63) / 64;
+    int tail = width % 64;
+    tail_mask = tail ? ((1ULL << tail) - 1) : ~0ULL;
+    words.assign(words_per_row * height, 0);
+}
+
+void BitBoard::pack(const std::vector<uint8_t>& map) {
+    #pragma omp parallel for
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* src = map.data() + (size_t)y * width;
+        uint64_t* row = words.data() + y * words_per_row;
+        for (size_t i = 0; i < words_per_row; ++i) {
+            uint64_t word = 0;
+            int end = std::min<int>(64, width - (int)(i * 64));
+            for (int b = 0; b < end; ++b) {
+                word |= (uint64_t)(src[i * 64 + b] != 0) << b;
+            }
+            row[i] = word;
+        }
+    }
+}
+
+void BitBoard::unpack(std::vector<uint8_t>& map) const {
+    #pragma omp parallel for
+    for (int y = 0; y < height; ++y) {
+        uint8_t* dst = map.data() + (size_t)y * width;
+        const uint64_t* row = words.data() + y * words_per_row;
+        for (int x = 0; x < width; ++x) {
+            dst[x] = (row[x / 64] >> (x % 64)) & 1;
+        }
+    }
+}
+
+void BitBoard::evolve(BitBoard& next) const {
+    #pragma omp parallel for
+    for (int y = 0; y < height; ++y) {
+        // Toroidal wrap of the rows is only an index calculation, no modulo inside the row
+        const uint64_t* up = words.data() + ((y + height - 1) % height) * words_per_row;
+        const uint64_t* mid = words.data() + y * words_per_row;
+        const uint64_t* down = words.data() + ((y + 1) % height) * words_per_row;
+        evolve_row(up, mid, down, next.words.data() + y * words_per_row);
+    }
+}
+
+void BitBoard::count_changes(const BitBoard& next, size_t& births, size_t& deaths) const {
+    size_t b = 0, d = 0;
+    const size_t blocks = words.size() / 8;
+    #pragma omp parallel for reduction(+:b, d)
+    for (size_t k = 0; k < blocks; ++k) {
+        uint64_t born[8], died[8];
+        for (int j = 0; j < 8; ++j) {
+            born[j] = next.words[8 * k + j] & ~words[8 * k + j];
+            died[j] = words[8 * k + j] & ~next.words[8 * k + j];
+        }
+        b += count_bits8(born);
+        d += count_bits8(died);
+    }
+    for (size_t i = blocks * 8; i < words.size(); ++i) {
+        b += count_bits(next.words[i] & ~words[i]);
+        d += count_bits(words[i] & ~next.words[i]);
+    }
+    births += b;
+    deaths += d;
+}
+
+void BitBoard::evolve_row(const uint64_t* up, const uint64_t* mid, const uint64_t* down, uint64_t* out) const {
+    const size_t last = words_per_row - 1;
+    const int tail_bit = (width - 1) % 64; // Position of the last cell inside the last word
+
+    // West neighbor of column x is x-1, so the words are shifted up by one bit and the carry comes from the
+    // previous word. For the first word the carry is the last cell of the row (toroidal wrap) and for the
+    // last word the east carry is the first cell of the row placed on the last valid bit.
+    auto west = [&](const uint64_t* r, size_t i) {
+        uint64_t carry = (i == 0) ? (r[last] >> tail_bit) & 1 : r[i - 1] >> 63;
+        return (r[i] << 1) | carry;
+    };
+    auto east = [&](const uint64_t* r, size_t i) {
+        uint64_t carry = (i == last) ? (r[0] & 1) << tail_bit : r[i + 1] << 63;
+        return (r[i] >> 1) | carry;
+    };
+
+    for (size_t i = 0; i < words_per_row; ++i) {
+        uint64_t aw = west(up, i), a = up[i], ae = east(up, i);
+        uint64_t mw = west(mid, i), m = mid[i], me = east(mid, i);
+        uint64_t bw = west(down, i), b = down[i], be = east(down, i);
+
+        // Full adders over the row above and below, half adder over the middle row (center excluded)
+        uint64_t a0 = aw ^ a ^ ae, a1 = (aw & a) | (ae & (aw ^ a));
+        uint64_t b0 = bw ^ b ^ be, b1 = (bw & b) | (be & (bw ^ b));
+        uint64_t m0 = mw ^ me, m1 = mw & me;
+
+        // Ones column of the total and its carry into the twos column
+        uint64_t s0 = a0 ^ b0 ^ m0;
+        uint64_t c0 = (a0 & b0) | (m0 & (a0 ^ b0));
+
+        // The total is 2 or 3 exactly when one of the four twos-bits is set
+        uint64_t x = a1 ^ b1, z = m1 ^ c0;
+        uint64_t twos_is_one = (x ^ z) & ~((a1 & b1) | (m1 & c0));
+
+        // B3/S23: born with 3, survives with 2 or 3
+        uint64_t result = twos_is_one & (s0 | m);
+        out[i] = (i == last) ? result & tail_mask : result;
+    }
+}
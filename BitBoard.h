@@ -0,0 +1,38 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
++ Bit-packed copy of the world: every row is stored as ceil(width/64) uint64_t words where bit b of
++ word i is the cell at column 64*i + b. The unused bits at the end of each row are always kept at 0.
+*/
+class BitBoard {
+    private:
+        int width = 0, height = 0;
+        size_t words_per_row = 0;
+        uint64_t tail_mask = ~0ULL; // Valid bits of the last word of a row
+        std::vector<uint64_t> words;
+
+        void evolve_row(const uint64_t* up, const uint64_t* mid, const uint64_t* down, uint64_t* out) const;
+
+    public:
+        BitBoard() = default;
+        BitBoard(int h, int w);
+
+        void pack(const std::vector<uint8_t>& map);
+        void unpack(std::vector<uint8_t>& map) const;
+        void evolve(BitBoard& next) const; // Computes the next generation into next (same size)
+        void count_changes(const BitBoard& next, size_t& births, size_t& deaths) const; // Popcount of the changed bits
+
+        bool operator==(const BitBoard& other) const {return words == other.words;}
+        bool operator!=(const BitBoard& other) const {return words != other.words;}
+
+        size_t get_words_per_row() const {return words_per_row;}
+        uint64_t* data() {return words.data();}
+        const uint64_t* data() const {return words.data();}
+};
+
+#endif //BITBOARD_H
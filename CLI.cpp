@@ -7,6 +7,7 @@
 class CLI{
     int t = 650;
     GameOfLife* gof;
+    bool profiling = false;
 
     void create_world(){
         int height, width, populate;
@@ -34,17 +35,17 @@ class CLI{
         if (t == 1){
             std::cout << "Populating using a normal distribution for the values" << std::endl;
             gof->simple_randomize();
-            std::cout << "World has been populated" << std::endl;
+            std::cout << "World has been populated (seed " << gof->get_seed() << ")" << std::endl;
             std::this_thread::sleep_for(std::chrono::milliseconds(t));
         } else if (t == 2){
             std::cout << "The standard values for the population is 0.7 Entropy within 10000 iterations" << std::endl;
             gof->randomize();
-            std::cout << "World has been populated" << std::endl;
+            std::cout << "World has been populated (seed " << gof->get_seed() << ")" << std::endl;
             std::this_thread::sleep_for(std::chrono::milliseconds(t));
         } else if (t == 3){
             std::cout << "The standard values for the population is 0.7 Entropy within 10000 iterations" << std::endl;
             gof->randomize1();
-            std::cout << "World has been populated" << std::endl;
+            std::cout << "World has been populated (seed " << gof->get_seed() << ")" << std::endl;
             std::this_thread::sleep_for(std::chrono::milliseconds(t));
         } else {
             std::cout << "The map will not be populated" << std::endl;
@@ -58,6 +59,9 @@ class CLI{
         std::cout << "Please enter the name/path to the file you want to load: ";
         std::cin >> path;
         gof = new GameOfLife(path);
+        if (gof->get_generation() > 0) {
+            std::cout << "Checkpoint loaded, the world continues at generation " << gof->get_generation() << std::endl;
+        }
         std::this_thread::sleep_for(std::chrono::milliseconds(t));
     }
 
@@ -67,11 +71,13 @@ class CLI{
             std::this_thread::sleep_for(std::chrono::milliseconds(t));
             return;
         }
-        std::string name;
-        std::cout << "What should be the name for the file? (.txt will be added): ";
+        std::string name, format;
+        std::cout << "In which format should the world be saved? (txt, bin=1 bit per cell or 1 byte with dying states, bin8=1 byte per cell): ";
+        std::cin >> format;
+        std::cout << "What should be the name for the file? (.txt or .bin will be added): ";
         std::cin >> name;
         std::cout << "The world has been saved into resources as "+name << std::endl;;
-        gof->save_game(name);
+        gof->save_game(name, format);
         std::this_thread::sleep_for(std::chrono::milliseconds(t));
     }
 
@@ -93,12 +99,70 @@ class CLI{
             return;
         }
         int t;
-        std::cout << "Please enter the amount of ms between evolutions (default 200ms)" << std::endl;
+        std::cout << "Please enter the amount of ms between two frames of the display (default 200ms)" << std::endl;
         std::cin >> t;
         gof->set_delay(t);
         std::this_thread::sleep_for(std::chrono::milliseconds(t));
     }
 
+    void set_viewport(){
+        if (!gof) {
+            std::cout << "No world created or loaded.\n";
+            std::this_thread::sleep_for(std::chrono::milliseconds(t));
+            return;
+        }
+        int x, y, cols, rows, block;
+        std::cout << "Please enter the top-left cell x y, the size of the view in columns and rows and the cells per character (e.g. 0 0 64 32 1, a block of 8 shows the density of 8x8 cells)" << std::endl;
+        std::cin >> x >> y >> cols >> rows >> block;
+        gof->set_viewport(x, y, cols, rows, block);
+        std::cout << "While the simulation is displayed the view can be moved with w/a/s/d and zoomed with +/-" << std::endl;
+        std::this_thread::sleep_for(std::chrono::milliseconds(t));
+    }
+
+    void set_checkpoints(){
+        if (!gof) {
+            std::cout << "No world created or loaded.\n";
+            std::this_thread::sleep_for(std::chrono::milliseconds(t));
+            return;
+        }
+        std::string name, compress;
+        int every;
+        double seconds;
+        std::cout << "What should be the name for the checkpoint? (.golc will be added, 0 turns the checkpoints off): ";
+        std::cin >> name;
+        if (name == "0") {
+            gof->set_checkpoints("", 0);
+            std::cout << "Checkpoints are OFF" << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(t));
+            return;
+        }
+        std::cout << "Please enter the generations and the seconds between two checkpoints (0 for either turns it off): ";
+        std::cin >> every >> seconds;
+        std::cout << "Compress the checkpoints with zlib? (y/n): ";
+        std::cin >> compress;
+        if (compress == "y" && !checkpoint_compression_available()) {
+            std::cout << "This build has no zlib, the checkpoints are not compressed" << std::endl;
+        }
+        gof->set_checkpoints("../resources/" + name + ".golc", every, seconds, compress == "y");
+        std::cout << "The checkpoints of the next runs are written into resources as " << name << ".golc, load it as a world to continue" << std::endl;
+        std::this_thread::sleep_for(std::chrono::milliseconds(t));
+    }
+
+    void set_cl_group(){
+        if (!gof) {
+            std::cout << "No world created or loaded.\n";
+            std::this_thread::sleep_for(std::chrono::milliseconds(t));
+            return;
+        }
+        int x, y, cells;
+        std::cout << "The OpenCL work-groups are " << gof->get_cl_group() << " (work-items in x and y, cells per work-item)" << std::endl;
+        std::cout << "Please enter the new work-items in x and y and the cells per work-item (default 32 8 4): ";
+        std::cin >> x >> y >> cells;
+        gof->set_cl_group(x, y, cells);
+        std::cout << "The next CL run uses " << gof->get_cl_group() << ", it is made smaller when the device does not support it" << std::endl;
+        std::this_thread::sleep_for(std::chrono::milliseconds(t));
+    }
+
     void run_evolution(){
         if (!gof) {
             std::cout << "No world created or loaded.\n";
@@ -109,8 +173,33 @@ class CLI{
         std::string type;
         std::cout << "Please enter the number of generation that should be simulated: ";
         std::cin >> n;
-        std::cout << "Please enter which method should be used for calculation (scalar or CL): ";
+        std::cout << "Please enter which method should be used for calculation (scalar, CL, CL-persistent, bitpacked, fused, omp, simd, tiled, temporal, hashlife, sparse or distributed): ";
         std::cin >> type;
+        if (type == "omp") {
+            std::string schedule;
+            int chunk;
+            std::cout << "Please enter the schedule for the row bands (static or dynamic) and the chunk size (0=auto): ";
+            std::cin >> schedule >> chunk;
+            gof->set_schedule(schedule, chunk);
+        }
+        if (type == "temporal") {
+            int k;
+            std::cout << "Please enter the number of generations per pass (k, data and the stability check are per pass): ";
+            std::cin >> k;
+            gof->set_temporal(k);
+        }
+        if (type == "CL-persistent") {
+            int k;
+            std::cout << "Please enter the number of generations queued before the stability flags are read (data is per batch): ";
+            std::cin >> k;
+            gof->set_cl_batch(k);
+        }
+        if (type == "distributed") {
+            int ranks;
+            std::cout << "Please enter the number of ranks (processes) the world is split into: ";
+            std::cin >> ranks;
+            gof->set_ranks(ranks);
+        }
         std::cout << "The simulation is starting... " << n << " generations will be simulated using " << type << std::endl;
         gof->run_simulation(n, type);
         std::this_thread::sleep_for(std::chrono::milliseconds(t));
@@ -141,6 +230,87 @@ class CLI{
         std::this_thread::sleep_for(std::chrono::milliseconds(t));
     }
 
+    void load_pattern() {
+        if (!gof) {
+            std::cout << "No world created or loaded.\n";
+            std::this_thread::sleep_for(std::chrono::milliseconds(t));
+            return;
+        }
+        std::string path;
+        int x, y;
+        std::cout << "Enter the path to the pattern (.rle or .cells) and the position of its top-left corner (x, y): ";
+        std::cin >> path >> x >> y;
+        gof->load_pattern(path, x, y);
+        std::this_thread::sleep_for(std::chrono::milliseconds(t));
+    }
+
+    void save_pattern() {
+        if (!gof) {
+            std::cout << "No world has been started, please start one before trying to save it.\n";
+            std::this_thread::sleep_for(std::chrono::milliseconds(t));
+            return;
+        }
+        std::string name, format;
+        std::cout << "In which format should the pattern be saved? (rle or cells): ";
+        std::cin >> format;
+        std::cout << "What should be the name for the file? (." << format << " will be added): ";
+        std::cin >> name;
+        gof->save_pattern(name, format);
+        std::cout << "The pattern has been saved into resources as " << name << "." << format << std::endl;
+        std::this_thread::sleep_for(std::chrono::milliseconds(t));
+    }
+
+    void set_rule() {
+        if (!gof) {
+            std::cout << "No world created or loaded.\n";
+            std::this_thread::sleep_for(std::chrono::milliseconds(t));
+            return;
+        }
+        std::string rulestring;
+        std::cout << "Enter the rule (e.g. B3/S23, B36/S23, B2/S/C3 or R5,C0,M1,S34..58,B34..45,NM): ";
+        std::cin >> rulestring;
+        try {
+            gof->set_rule(rulestring);
+            std::cout << "The rule is now " << gof->get_rule() << std::endl;
+        } catch (const std::invalid_argument& e) {
+            std::cout << e.what() << std::endl;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(t));
+    }
+
+    void toggle_profiling() {
+        if (!gof) {
+            std::cout << "No world created or loaded.\n";
+            std::this_thread::sleep_for(std::chrono::milliseconds(t));
+            return;
+        }
+        profiling = !profiling;
+        gof->set_profiling(profiling);
+        std::cout << "Profiling of the simulation phases is now " << (profiling ? "ON" : "OFF") << " (standard is OFF)" << std::endl;
+        std::this_thread::sleep_for(std::chrono::milliseconds(t));
+    }
+
+    void save_profile() {
+        if (!gof) {
+            std::cout << "No world created or loaded.\n";
+            std::this_thread::sleep_for(std::chrono::milliseconds(t));
+            return;
+        }
+        for (const auto& [phase, seconds] : Profiler::get().totals()) {
+            std::cout << phase << ": " << seconds * 1e3 << " ms" << std::endl;
+        }
+
+        std::string name;
+        std::cout << "What should be the name for the trace? (.json will be added, open it in chrome://tracing): ";
+        std::cin >> name;
+        if (gof->save_trace("../resources/" + name + ".json")) {
+            std::cout << "The trace has been saved into resources as " << name << ".json" << std::endl;
+        } else {
+            std::cerr << "Failed to open file " << name << ".json for writing." << std::endl;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(t));
+    }
+
     void set_cell(){
         if (!gof) {
             std::cout << "No world created or loaded.\n";
@@ -172,14 +342,19 @@ class CLI{
             return;
         }
 
-        std::chrono::duration<double> last;
+        std::chrono::duration<double> last(0);
         auto data = gof->get_data();
-        for (const auto& duration : data) {
-            std::cout << std::chrono::duration_cast<TimeUnit_t>(duration).count() << " ms" << std::endl;
-            last += duration; 
+        auto generations = gof->get_data_generations();
+        for (size_t k = 0; k < data.size(); ++k) {
+            std::cout << std::chrono::duration<double, std::milli>(data[k]).count() << " ms";
+            if (generations[k] > 1) {
+                std::cout << " (" << generations[k] << " generations)"; // hashlife, temporal and CL-persistent
+            }
+            std::cout << std::endl;
+            last += data[k];
         }
 
-        std::cout << "The simulation took in total " << std::chrono::duration_cast<TimeUnit_t>(last).count() << " ms" << std::endl;
+        std::cout << "The simulation took in total " << std::chrono::duration<double, std::milli>(last).count() << " ms" << std::endl;
 
         std::cout << "Press enter to go back to the menu" << std::endl;
         std::cin.ignore(); 
@@ -239,6 +414,14 @@ public:
                       << "10. Add figure\n"
                       << "11. Present data\n"
                       << "12. Save data\n"
+                      << "13. Load pattern\n"
+                      << "14. Save pattern\n"
+                      << "15. Toggle profiling\n"
+                      << "16. Save profile\n"
+                      << "17. Set rule\n"
+                      << "18. Set viewport\n"
+                      << "19. Set checkpoints\n"
+                      << "20. Set OpenCL work-group\n"
                       << "0. Exit\n"
                       << "Enter choice: ";
             std::cin >> choice;
@@ -255,6 +438,14 @@ public:
                 case 10: add_figure(); break;
                 case 11: present_data(); break;
                 case 12: store_data(); break;
+                case 13: load_pattern(); break;
+                case 14: save_pattern(); break;
+                case 15: toggle_profiling(); break;
+                case 16: save_profile(); break;
+                case 17: set_rule(); break;
+                case 18: set_viewport(); break;
+                case 19: set_checkpoints(); break;
+                case 20: set_cl_group(); break;
                 case 0: break;
                 default: std::cout << "Invalid choice, try again.\n";
             }
@@ -0,0 +1,307 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef GOL_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#include "../include/Checkpoint.h"
+
+static const char MAGIC[4] = {'G', 'O', 'L', 'C'};
+static const uint32_t VERSION = 3;
+
+bool is_checkpoint(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    char magic[4] = {0, 0, 0, 0};
+    bool checkpoint = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && std::memcmp(magic, MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return checkpoint;
+}
+
+bool checkpoint_compression_available() {
+#ifdef GOL_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Unpacks a stored world of cells cells into map
+static void decode_world(const std::string& path, std::vector<uint8_t>& payload, WorldEncoding encoding,
+                         uint32_t compression, size_t cells, std::vector<uint8_t>& map) {
+    size_t size = encoding == WorldEncoding::BITS ? (cells + 7) / 8 : cells;
+    std::vector<uint8_t> stored;
+    if (compression == 1) {
+#ifdef GOL_HAVE_ZLIB
+        stored.resize(size);
+        uLongf length = size;
+        if (uncompress(stored.data(), &length, payload.data(), payload.size()) != Z_OK || length != size) {
+            throw std::runtime_error("Corrupted compressed checkpoint: " + path);
+        }
+#else
+        throw std::runtime_error("The checkpoint is compressed and this build has no zlib: " + path);
+#endif
+    } else if (payload.size() == size) {
+        stored.swap(payload);
+    } else {
+        throw std::runtime_error("Invalid or truncated checkpoint: " + path);
+    }
+
+    if (encoding == WorldEncoding::BYTES) {
+        map.swap(stored);
+        return;
+    }
+    map.resize(cells);
+    #pragma omp parallel for
+    for (long long i = 0; i < (long long)cells; ++i) {
+        map[i] = (stored[i / 8] >> (i % 8)) & 1;
+    }
+}
+
+// Packs map into bits, false when a cell has a dying state and the world has to be stored as bytes
+static bool pack_world(const std::vector<uint8_t>& map, std::vector<uint8_t>& bits) {
+    // Runs next to the simulation, so the packing is not parallel and does not take the cores of its threads.
+    // The low bits of 8 cells are gathered into the top byte with one multiply.
+    size_t cells = map.size();
+    bits.assign((cells + 7) / 8, 0);
+    bool two_states = true;
+    size_t b = 0;
+    for (; b < cells / 8 && two_states; ++b) {
+        uint64_t word;
+        std::memcpy(&word, map.data() + b * 8, 8);
+        two_states = (word & 0xFEFEFEFEFEFEFEFEull) == 0;
+        bits[b] = (uint8_t)((word * 0x0102040810204080ull) >> 56);
+    }
+    for (size_t i = b * 8; i < cells && two_states; ++i) {
+        bits[i / 8] |= (map[i] & 1) << (i % 8);
+        two_states = map[i] <= 1;
+    }
+    return two_states;
+}
+
+// Compresses stored into compressed when compress is set and zlib is available, returns the bytes to write
+static const std::vector<uint8_t>& compress_world(const std::string& path, const std::vector<uint8_t>& stored,
+                                                  bool compress, std::vector<uint8_t>& compressed) {
+#ifdef GOL_HAVE_ZLIB
+    if (compress) {
+        // Level 1, the sparse parts of a world shrink a lot already and the writer keeps up with short intervals
+        uLongf size = compressBound(stored.size());
+        compressed.resize(size);
+        if (compress2(compressed.data(), &size, stored.data(), stored.size(), 1) != Z_OK) {
+            throw std::runtime_error("Failed to compress checkpoint: " + path);
+        }
+        compressed.resize(size);
+        return compressed;
+    }
+#else
+    (void)path;
+    (void)compress;
+    (void)compressed;
+#endif
+    return stored;
+}
+
+void read_checkpoint(const std::string& path, Checkpoint& checkpoint) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    CheckpointHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 && std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+              && header.version >= 1 && header.version <= VERSION && header.compression <= 1
+              && (header.encoding == (uint32_t)WorldEncoding::BYTES || header.encoding == (uint32_t)WorldEncoding::BITS);
+    size_t cells = (size_t)header.height * header.width;
+    std::string rule(valid ? header.rule_length : 0, '\0');
+    std::vector<double> data(valid ? header.samples : 0);
+    // Version 1 has no generations, every entry was one generation then
+    std::vector<uint32_t> data_generations(valid ? header.samples : 0, 1);
+    size_t generations_stored = valid && header.version >= 2 ? data_generations.size() : 0;
+    std::vector<uint8_t> payload(valid ? header.payload_size : 0);
+    valid = valid && fread(&rule[0], 1, rule.size(), file) == rule.size()
+                  && fread(data.data(), sizeof(double), data.size(), file) == data.size()
+                  && fread(data_generations.data(), sizeof(uint32_t), generations_stored, file) == generations_stored
+                  && fread(payload.data(), 1, payload.size(), file) == payload.size();
+    // Since version 3 the generation before the world follows it, encoded and compressed the same way
+    uint64_t past_size = 0;
+    std::vector<uint8_t> past_payload;
+    if (valid && header.version >= 3) {
+        valid = fread(&past_size, sizeof(past_size), 1, file) == 1;
+        past_payload.resize(valid ? past_size : 0);
+        valid = valid && fread(past_payload.data(), 1, past_payload.size(), file) == past_payload.size();
+    }
+    fclose(file);
+    if (!valid) {
+        throw std::runtime_error("Invalid or truncated checkpoint: " + path);
+    }
+
+    WorldEncoding encoding = static_cast<WorldEncoding>(header.encoding);
+    std::vector<uint8_t> map, past;
+    decode_world(path, payload, encoding, header.compression, cells, map);
+    if (header.version >= 3) {
+        decode_world(path, past_payload, encoding, header.compression, cells, past);
+    }
+
+    checkpoint.height = header.height;
+    checkpoint.width = header.width;
+    checkpoint.generation = header.generation;
+    checkpoint.rule = rule;
+    checkpoint.data = data;
+    checkpoint.data_generations = data_generations;
+    checkpoint.map.swap(map);
+    checkpoint.past.swap(past);
+}
+
+void write_checkpoint(const std::string& path, const Checkpoint& checkpoint, bool compress) {
+    if (checkpoint.data_generations.size() != checkpoint.data.size()) {
+        throw std::runtime_error("The generations of the data do not match the data: " + path);
+    }
+    size_t cells = (size_t)checkpoint.height * checkpoint.width;
+    if (checkpoint.map.size() != cells || checkpoint.past.size() != cells) {
+        throw std::runtime_error("The world does not match the size of the checkpoint: " + path);
+    }
+    // Both worlds share the encoding, bits only when neither has a dying state
+    std::vector<uint8_t> bits, past_bits;
+    bool two_states = pack_world(checkpoint.map, bits) && pack_world(checkpoint.past, past_bits);
+    WorldEncoding encoding = two_states ? WorldEncoding::BITS : WorldEncoding::BYTES;
+
+    CheckpointHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.height = checkpoint.height;
+    header.width = checkpoint.width;
+    header.generation = checkpoint.generation;
+    header.encoding = static_cast<uint32_t>(encoding);
+    header.compression = compress && checkpoint_compression_available() ? 1 : 0;
+    header.rule_length = checkpoint.rule.size();
+    header.samples = checkpoint.data.size();
+
+    std::vector<uint8_t> compressed, past_compressed;
+    const std::vector<uint8_t>& payload = compress_world(path, two_states ? bits : checkpoint.map, compress, compressed);
+    const std::vector<uint8_t>& past_payload = compress_world(path, two_states ? past_bits : checkpoint.past, compress, past_compressed);
+    header.payload_size = payload.size();
+    uint64_t past_size = past_payload.size();
+
+    std::string temp = path + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Failed to open file for writing: " + temp);
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(checkpoint.rule.data(), 1, checkpoint.rule.size(), file) == checkpoint.rule.size()
+           && fwrite(checkpoint.data.data(), sizeof(double), checkpoint.data.size(), file) == checkpoint.data.size()
+           && fwrite(checkpoint.data_generations.data(), sizeof(uint32_t), checkpoint.data.size(), file) == checkpoint.data.size()
+           && fwrite(payload.data(), 1, payload.size(), file) == payload.size()
+           && fwrite(&past_size, sizeof(past_size), 1, file) == 1
+           && fwrite(past_payload.data(), 1, past_payload.size(), file) == past_payload.size()
+           && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        throw std::runtime_error("Failed to write checkpoint: " + path);
+    }
+
+    // The rename itself is only durable once the directory is synced
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    int fd = open(directory.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+void CheckpointWriter::start(const std::string& file, bool zlib) {
+    stop();
+    path = file;
+    compress = zlib;
+    written = 0;
+    failed = 0;
+    // The worker is stopped, nothing else uses the buffers now
+    for (Checkpoint* buffer : {&snapshot, &writing}) {
+        buffer->data.clear();
+        buffer->data_generations.clear();
+    }
+    running = true;
+    worker = std::thread(&CheckpointWriter::loop, this);
+}
+
+void CheckpointWriter::stop() {
+    if (!worker.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running = false;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+bool CheckpointWriter::submit(int height, int width, uint64_t generation, const std::string& rule,
+                              const std::vector<uint8_t>& past, const std::vector<uint8_t>& map,
+                              const std::vector<std::chrono::duration<double>>& data,
+                              const std::vector<uint32_t>& data_generations, bool wait) {
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        if (wait) {
+            done.wait(guard, [this]() {return !pending;});
+        }
+        if (pending || !running) {
+            return false;
+        }
+        // Only a copy, the bytes are packed on the writer thread
+        snapshot.height = height;
+        snapshot.width = width;
+        snapshot.generation = generation;
+        snapshot.rule = rule;
+        // The buffer already holds the history up to its last checkpoint, only the entries since then are copied
+        size_t kept = snapshot.data.size() <= data.size() ? snapshot.data.size() : 0;
+        snapshot.data.resize(kept);
+        snapshot.data_generations.resize(kept);
+        for (size_t k = kept; k < data.size(); ++k) {
+            snapshot.data.push_back(data[k].count());
+        }
+        snapshot.data_generations.insert(snapshot.data_generations.end(), data_generations.begin() + kept, data_generations.end());
+        snapshot.map.resize(map.size());
+        std::memcpy(snapshot.map.data(), map.data(), map.size());
+        snapshot.past.resize(past.size());
+        std::memcpy(snapshot.past.data(), past.data(), past.size());
+        pending = true;
+        free.store(false, std::memory_order_release);
+    }
+    wake.notify_all();
+    return true;
+}
+
+void CheckpointWriter::loop() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [this]() {return pending || !running;});
+        if (!pending) {
+            break;
+        }
+        std::swap(snapshot, writing);
+        pending = false;
+        free.store(true, std::memory_order_release);
+        done.notify_all();
+        guard.unlock();
+
+        try {
+            write_checkpoint(path, writing, compress);
+            written++;
+        } catch (const std::exception& e) {
+            failed++;
+            std::cerr << "Checkpoint of generation " << writing.generation << " failed: " << e.what() << std::endl;
+        }
+        guard.lock();
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "WorldFile.h"
+
+/*
++ Checkpoint format, a 56 byte header followed by the name of the rule, the timing history and the world:
++   the rule as rule_length characters, samples doubles (seconds of every entry of get_data()), samples uint32
++   (generations of every entry, only since version 2, version 1 entries are one generation each) and the world
++   encoded like a binary world (BITS, or BYTES when it has the dying states of a Generations rule), compressed
++   with zlib when compression is 1. Since version 3 the generation before the world follows it as a uint64 size
++   and the stored bytes, with the same encoding and compression; the stability check compares the next
++   generation against it, so a resumed run stops where the uninterrupted one would.
++ All the values are stored little endian. A checkpoint is written into path.tmp and renamed over path after
++ it was flushed to the disk, so path always holds a complete checkpoint, even when the process is killed.
+*/
+struct CheckpointHeader {
+    char magic[4];         // "GOLC"
+    uint32_t version;      // 3
+    uint32_t height;
+    uint32_t width;
+    uint64_t generation;   // Of the world since it was created
+    uint32_t encoding;     // WorldEncoding
+    uint32_t compression;  // 0 none, 1 zlib
+    uint32_t rule_length;
+    uint32_t reserved;
+    uint64_t samples;
+    uint64_t payload_size; // Stored bytes of the world
+};
+
+struct Checkpoint {
+    int height = 0, width = 0;
+    uint64_t generation = 0;
+    std::string rule;
+    std::vector<double> data;
+    std::vector<uint32_t> data_generations; // Same length as data
+    std::vector<uint8_t> map; // One byte per cell
+    std::vector<uint8_t> past; // Generation before map, empty when read from version 1 and 2
+};
+
+bool is_checkpoint(const std::string& path); // Checks the magic
+bool checkpoint_compression_available(); // False when built without zlib, compress is then ignored
+void read_checkpoint(const std::string& path, Checkpoint& checkpoint);
+void write_checkpoint(const std::string& path, const Checkpoint& checkpoint, bool compress);
+
+/*
++ Writes checkpoints on its own thread. submit() copies the world into a buffer of the writer and returns, the
++ packing, compression and the write happen while the simulation goes on. There are two buffers, while one is
++ written the next checkpoint can be submitted; when both are in use ready() is false and the simulation tries
++ again after the next generation. A failed write is reported on stderr and does not stop the simulation.
++ The timing history only grows during a run, so every buffer only appends the entries since its last checkpoint.
+*/
+class CheckpointWriter {
+    private:
+        std::thread worker;
+        std::mutex lock;
+        std::condition_variable wake, done;
+        std::atomic<bool> free{true}; // The buffer for the next checkpoint is not in use
+        bool running = false;
+        bool pending = false;
+        Checkpoint snapshot, writing;
+        std::string path;
+        bool compress = false;
+        std::atomic<size_t> written{0}, failed{0}; // Counted by the writer thread, read by the simulation
+
+        void loop();
+
+    public:
+        CheckpointWriter() = default;
+        ~CheckpointWriter() {stop();}
+        CheckpointWriter(const CheckpointWriter&) = delete;
+        CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+        void start(const std::string& file, bool zlib);
+        void stop(); // Waits until the submitted checkpoints are written
+
+        bool ready() const {return free.load(std::memory_order_acquire);}
+        // Waits for the buffer when wait is true (the last checkpoint of a run), otherwise false when it is in use
+        bool submit(int height, int width, uint64_t generation, const std::string& rule,
+                    const std::vector<uint8_t>& past, const std::vector<uint8_t>& map,
+                    const std::vector<std::chrono::duration<double>>& data, const std::vector<uint32_t>& data_generations,
+                    bool wait = false);
+        size_t get_written() const {return written.load();}
+        size_t get_failed() const {return failed.load();}
+};
+
+#endif //CHECKPOINT_H
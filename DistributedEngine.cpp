@@ -0,0 +1,296 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../include/DistributedEngine.h"
+#include "../include/Stencil.h"
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Atomics in shared memory must be lock free");
+
+HaloTransport::HaloTransport(int ranks, size_t halo_bytes, size_t extra_bytes) : ranks(ranks), halo_bytes(halo_bytes) {
+    size_t control_size = (sizeof(Control) + 63) / 64 * 64;
+    size_t slots_size = ranks * sizeof(Slot);
+    size_t outbox_size = (ranks * halo_bytes + 63) / 64 * 64;
+    mapping_size = control_size + slots_size + outbox_size + extra_bytes;
+
+    void* memory = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("Failed to map the shared memory of the ranks.");
+    }
+    mapping = static_cast<uint8_t*>(memory);
+    control = new (mapping) Control{};
+    control->aborted.store(0);
+    control->arrived.store(0);
+    slots = reinterpret_cast<Slot*>(mapping + control_size);
+    for (int r = 0; r < ranks; ++r) {
+        new (&slots[r]) Slot{};
+        slots[r].ready.store(0);
+    }
+    outboxes = mapping + control_size + slots_size;
+    extra = outboxes + outbox_size;
+}
+
+HaloTransport::~HaloTransport() {
+    if (mapping) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+template <typename Ready>
+void HaloTransport::wait_for(Ready ready) const {
+    // The ranks can outnumber the cores, so after a short spin the core is given to someone else
+    for (int spin = 0; !ready(); ++spin) {
+        if (aborted()) {
+            throw std::runtime_error("Another rank failed.");
+        }
+        if (spin > 64) {
+            sched_yield();
+        }
+    }
+}
+
+void HaloTransport::publish(uint64_t gen) {
+    slots[me].ready.store(gen + 1, std::memory_order_release);
+}
+
+const uint8_t* HaloTransport::receive(int from, uint64_t gen) const {
+    wait_for([&]() { return slots[from].ready.load(std::memory_order_acquire) > gen; });
+    return outboxes + from * halo_bytes;
+}
+
+uint32_t HaloTransport::allreduce_or(uint32_t bits, uint64_t gen) {
+    /*
+    + The counter only grows, generation gen is complete when every rank arrived gen+1 times. A rank writes
+    + the flags of gen+2 into the same parity only after everybody arrived at gen+1, so after reading gen.
+    */
+    slots[me].flags[gen % 2] = bits;
+    control->arrived.fetch_add(1, std::memory_order_acq_rel);
+    uint64_t target = (uint64_t)ranks * (gen + 1);
+    wait_for([&]() { return control->arrived.load(std::memory_order_acquire) >= target; });
+
+    uint32_t result = 0;
+    for (int r = 0; r < ranks; ++r) {
+        result |= slots[r].flags[gen % 2];
+    }
+    return result;
+}
+
+DistributedEngine::DistributedEngine(int h, int w, int ranks) : width(w), height(h) {
+    // Grid with the shortest block border (least halo traffic), every block has at least one cell
+    double best = -1;
+    for (int y = 1; y <= ranks; ++y) {
+        int x = ranks / y;
+        if (ranks % y != 0 || y > height || x > width) {
+            continue;
+        }
+        double border = (double)height / y + (double)width / x;
+        if (best < 0 || border < best) {
+            best = border;
+            py = y;
+            px = x;
+        }
+    }
+}
+
+DistributedEngine::Block DistributedEngine::block(int rank) const {
+    int by = rank / px, bx = rank % px;
+    int y0 = (int)((int64_t)height * by / py), y1 = (int)((int64_t)height * (by + 1) / py);
+    int x0 = (int)((int64_t)width * bx / px), x1 = (int)((int64_t)width * (bx + 1) / px);
+    return {y0, x0, y1 - y0, x1 - x0};
+}
+
+int DistributedEngine::rank_of(int by, int bx) const {
+    return ((by + py) % py) * px + (bx + px) % px;
+}
+
+void DistributedEngine::run_rank(HaloTransport& transport, int gens, double* times, uint64_t* gens_done, uint32_t* stable) const {
+    const int rank = transport.rank();
+    const Block b = block(rank);
+    const int by = rank / px, bx = rank % px;
+    const int h = b.h, w = b.w, stride = w + 2;
+    uint8_t* world_past = transport.shared() + 16 + gens * sizeof(double);
+    uint8_t* world_present = world_past + (size_t)width * height;
+
+    // Own generations with a one cell ghost border, cell (y, x) of the block is at (y+1)*stride + x+1
+    std::vector<uint8_t> buffers[3];
+    for (auto& buffer : buffers) {
+        buffer.assign((size_t)(h + 2) * stride, 0);
+    }
+    uint8_t *past = buffers[0].data(), *present = buffers[1].data(), *future = buffers[2].data();
+    auto cell = [stride](uint8_t* map, int y, int x) -> uint8_t& { return map[(y + 1) * stride + x + 1]; };
+
+    // Scatter and gather only touch the own block of the shared world
+    for (int y = 0; y < h; ++y) {
+        std::memcpy(&cell(past, y, 0), world_past + (size_t)(b.y0 + y) * width + b.x0, w);
+        std::memcpy(&cell(present, y, 0), world_present + (size_t)(b.y0 + y) * width + b.x0, w);
+    }
+
+    const int north = rank_of(by - 1, bx), south = rank_of(by + 1, bx);
+    const int west = rank_of(by, bx - 1), east = rank_of(by, bx + 1);
+    const int north_west = rank_of(by - 1, bx - 1), north_east = rank_of(by - 1, bx + 1);
+    const int south_west = rank_of(by + 1, bx - 1), south_east = rank_of(by + 1, bx + 1);
+
+    // Halo layout: top row, bottom row, left column, right column, then the corners nw, ne, sw, se
+    struct Halo {size_t top, bottom, left, right, corners;};
+    auto halo_of = [this](int r) {
+        Block o = block(r);
+        return Halo{0, (size_t)o.w, (size_t)2 * o.w, (size_t)2 * o.w + o.h, (size_t)2 * o.w + 2 * o.h};
+    };
+    const Halo own = halo_of(rank);
+    const Halo from_north = halo_of(north), from_south = halo_of(south), from_west = halo_of(west), from_east = halo_of(east);
+    const Halo from_nw = halo_of(north_west), from_ne = halo_of(north_east);
+    const Halo from_sw = halo_of(south_west), from_se = halo_of(south_east);
+
+    auto rows = [&](int y0, int y1, int x0, int x1) {
+        for (int y = y0; y < y1; ++y) {
+            const uint8_t* mid = present + (y + 1) * stride;
+            evolve_span(mid - stride, mid, mid + stride, future + (y + 1) * stride, stride, x0 + 1, x1 + 1);
+        }
+    };
+
+    for (int gen = 0; gen < gens; ++gen) {
+        auto start = std::chrono::steady_clock::now();
+
+        uint8_t* out = transport.send_buffer();
+        std::memcpy(out + own.top, &cell(present, 0, 0), w);
+        std::memcpy(out + own.bottom, &cell(present, h - 1, 0), w);
+        for (int y = 0; y < h; ++y) {
+            out[own.left + y] = cell(present, y, 0);
+            out[own.right + y] = cell(present, y, w - 1);
+        }
+        out[own.corners + 0] = cell(present, 0, 0);
+        out[own.corners + 1] = cell(present, 0, w - 1);
+        out[own.corners + 2] = cell(present, h - 1, 0);
+        out[own.corners + 3] = cell(present, h - 1, w - 1);
+        transport.publish(gen);
+
+        // The inside of the block does not need the ghost cells, this hides the wait for the neighbors
+        rows(1, h - 1, 1, w - 1);
+
+        std::memcpy(&cell(present, -1, 0), transport.receive(north, gen) + from_north.bottom, w);
+        std::memcpy(&cell(present, h, 0), transport.receive(south, gen) + from_south.top, w);
+        const uint8_t* in = transport.receive(west, gen) + from_west.right;
+        for (int y = 0; y < h; ++y) {
+            cell(present, y, -1) = in[y];
+        }
+        in = transport.receive(east, gen) + from_east.left;
+        for (int y = 0; y < h; ++y) {
+            cell(present, y, w) = in[y];
+        }
+        cell(present, -1, -1) = transport.receive(north_west, gen)[from_nw.corners + 3];
+        cell(present, -1, w) = transport.receive(north_east, gen)[from_ne.corners + 2];
+        cell(present, h, -1) = transport.receive(south_west, gen)[from_sw.corners + 1];
+        cell(present, h, w) = transport.receive(south_east, gen)[from_se.corners + 0];
+
+        // Border of the block: first and last row, first and last column
+        rows(0, 1, 0, w);
+        rows(h - 1, h, 0, w);
+        rows(1, h - 1, 0, 1);
+        rows(1, h - 1, w - 1, w);
+
+        // Bit 0: the block changed from n to n+1, bit 1: the block differs from n-1
+        uint32_t bits = 0;
+        for (int y = 0; y < h && bits != 3; ++y) {
+            if (std::memcmp(&cell(future, y, 0), &cell(present, y, 0), w) != 0) bits |= 1;
+            if (std::memcmp(&cell(future, y, 0), &cell(past, y, 0), w) != 0) bits |= 2;
+        }
+        uint32_t global = transport.allreduce_or(bits, gen);
+
+        if (rank == 0) {
+            times[gen] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            *gens_done = gen + 1;
+        }
+        if ((global & 1) == 0 || (global & 2) == 0) {
+            if (rank == 0) {
+                *stable = 1;
+            }
+            break;
+        }
+        uint8_t* oldest = past;
+        past = present;
+        present = future;
+        future = oldest;
+    }
+
+    for (int y = 0; y < h; ++y) {
+        std::memcpy(world_past + (size_t)(b.y0 + y) * width + b.x0, &cell(past, y, 0), w);
+        std::memcpy(world_present + (size_t)(b.y0 + y) * width + b.x0, &cell(present, y, 0), w);
+    }
+}
+
+bool DistributedEngine::run(std::vector<uint8_t>& past, std::vector<uint8_t>& present, int gens, std::vector<double>& times) {
+    const int ranks = get_ranks();
+    const size_t w_size = (size_t)width * height;
+
+    size_t halo_bytes = 0;
+    for (int r = 0; r < ranks; ++r) {
+        Block b = block(r);
+        halo_bytes = std::max(halo_bytes, (size_t)2 * b.w + 2 * b.h + 4);
+    }
+    // Shared: generations done, stable flag, time of every generation, then the world (past and present)
+    HaloTransport transport(ranks, halo_bytes, 16 + gens * sizeof(double) + 2 * w_size);
+    uint8_t* shared = transport.shared();
+    uint64_t* gens_done = reinterpret_cast<uint64_t*>(shared);
+    uint32_t* stable = reinterpret_cast<uint32_t*>(shared + 8);
+    double* gen_times = reinterpret_cast<double*>(shared + 16);
+    uint8_t* world_past = shared + 16 + gens * sizeof(double);
+    uint8_t* world_present = world_past + w_size;
+    std::copy(past.begin(), past.end(), world_past);
+    std::copy(present.begin(), present.end(), world_present);
+
+    // Buffered output would otherwise be written once by every rank
+    fflush(nullptr);
+
+    std::vector<pid_t> children;
+    bool failed = false;
+    for (int r = 0; r < ranks; ++r) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int code = 0;
+            try {
+                transport.set_rank(r);
+                run_rank(transport, gens, gen_times, gens_done, stable);
+            } catch (...) {
+                transport.abort();
+                code = 1;
+            }
+            _exit(code);
+        }
+        if (pid < 0) {
+            transport.abort();
+            failed = true;
+            break;
+        }
+        children.push_back(pid);
+    }
+
+    for (size_t done = 0; done < children.size(); ++done) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            break;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            // A rank that crashed never publishes again, the others are woken up by the abort
+            transport.abort();
+            failed = true;
+        }
+    }
+    if (failed) {
+        throw std::runtime_error("A rank of the distributed simulation failed.");
+    }
+
+    std::copy(world_past, world_past + w_size, past.begin());
+    std::copy(world_present, world_present + w_size, present.begin());
+    times.assign(gen_times, gen_times + *gens_done);
+    return *stable != 0;
+}
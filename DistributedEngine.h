@@ -0,0 +1,89 @@
+#ifndef DISTRIBUTEDENGINE_H
+#define DISTRIBUTEDENGINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
++ Message passing between the ranks of one machine, the operations follow MPI (point to point halos, a
++ reduction, abort) but run over a MAP_SHARED mapping that is created before the ranks are forked.
++ Every rank has one outbox for its halos, publish(gen) makes the halos of generation gen visible and
++ receive() waits until the neighbor published them. allreduce_or() is also the barrier of the generation,
++ which is what makes a single outbox per rank enough: nobody overwrites halos that are still being read.
+*/
+class HaloTransport {
+    private:
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> ready; // Last generation published + 1
+            uint32_t flags[2];           // Reduction input, by generation parity
+        };
+        struct Control {
+            std::atomic<uint32_t> aborted;
+            std::atomic<uint64_t> arrived; // Ranks that reached the reduction, over all generations
+        };
+
+        int ranks = 1, me = 0;
+        size_t halo_bytes = 0;
+        size_t mapping_size = 0;
+        uint8_t* mapping = nullptr;
+        Control* control = nullptr;
+        Slot* slots = nullptr;
+        uint8_t* outboxes = nullptr;
+        uint8_t* extra = nullptr;
+
+        template <typename Ready>
+        void wait_for(Ready ready) const;
+
+    public:
+        HaloTransport(int ranks, size_t halo_bytes, size_t extra_bytes);
+        ~HaloTransport();
+        HaloTransport(const HaloTransport&) = delete;
+        HaloTransport& operator=(const HaloTransport&) = delete;
+
+        void set_rank(int rank) {me = rank;} // Called in every forked rank
+        int rank() const {return me;}
+        int size() const {return ranks;}
+        uint8_t* send_buffer() {return outboxes + me * halo_bytes;}
+        void publish(uint64_t gen);
+        const uint8_t* receive(int from, uint64_t gen) const;
+        uint32_t allreduce_or(uint32_t bits, uint64_t gen);
+        void abort() {control->aborted.store(1);}  // Wakes up every waiting rank, they leave with an error
+        bool aborted() const {return control->aborted.load() != 0;}
+        uint8_t* shared() {return extra;} // Shared bytes for the scatter/gather of the world
+};
+
+/*
++ Toroidal world split into a px x py grid of blocks, every block is owned by one forked rank that only
++ keeps its own past/present/future with a one cell ghost border. Each generation a rank publishes its
++ border, computes the inside of the block while the neighbors do the same, then fills the ghost cells
++ from the neighbors and computes the border. The stability check is a global OR over the blocks.
+*/
+class DistributedEngine {
+    private:
+        struct Block {int y0, x0, h, w;};
+
+        int width = 0, height = 0;
+        int px = 1, py = 1;
+
+        Block block(int rank) const;
+        int rank_of(int by, int bx) const;
+        void run_rank(HaloTransport& transport, int gens, double* times, uint64_t* gens_done, uint32_t* stable) const;
+
+    public:
+        DistributedEngine() = default;
+        DistributedEngine(int h, int w, int ranks);
+
+        int get_ranks() const {return px * py;}
+        int get_grid_x() const {return px;}
+        int get_grid_y() const {return py;}
+        /*
+        + Runs up to gens generations, past/present are scattered to the ranks and gathered back at the end.
+        + times gets the duration of every generation (measured on rank 0), returns true when the world
+        + became stable. Throws std::runtime_error when a rank failed.
+        */
+        bool run(std::vector<uint8_t>& past, std::vector<uint8_t>& present, int gens, std::vector<double>& times);
+};
+
+#endif //DISTRIBUTEDENGINE_H
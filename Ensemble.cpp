@@ -0,0 +1,172 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include "../include/Ensemble.h"
+#include "../include/Seeding.h"
+
+Ensemble::Ensemble(size_t count, int h, int w) : width(w), height(h), count(count) {
+    cells = (size_t)width * height;
+    groups = (count + 63) / 64;
+    worlds.assign(groups * cells, 0);
+    final_state.assign(groups * cells, 0);
+    stats.assign(count, EnsembleStats{0, 0, 0, 0, 0});
+}
+
+void Ensemble::randomize(uint64_t seed, double density) {
+    // World k is stream k of seed_random(), world 0 is the world of GameOfLife::simple_randomize() with this seed
+    const uint64_t threshold = density_threshold(density);
+    const bool all = density >= 1.0;
+    #pragma omp parallel for
+    for (size_t g = 0; g < groups; ++g) {
+        uint64_t* group = worlds.data() + g * cells;
+        const size_t last = std::min(count, g * 64 + 64);
+        for (size_t c = 0; c < cells; ++c) {
+            uint64_t word = 0;
+            for (size_t k = g * 64; k < last; ++k) {
+                word |= (uint64_t)(all || random_at(seed, k, c) < threshold) << (k % 64);
+            }
+            group[c] = word;
+        }
+    }
+    finished = false;
+}
+
+void Ensemble::set_world(size_t k, const std::vector<uint8_t>& map) {
+    if (k >= count || map.size() != cells) {
+        throw std::runtime_error("Ensemble: world index or size does not match.");
+    }
+    uint64_t* group = worlds.data() + (k / 64) * cells;
+    uint64_t bit = 1ULL << (k % 64);
+    for (size_t c = 0; c < cells; ++c) {
+        group[c] = map[c] ? (group[c] | bit) : (group[c] & ~bit);
+    }
+    finished = false;
+}
+
+std::vector<uint8_t> Ensemble::get_world(size_t k) const {
+    if (k >= count) {
+        throw std::runtime_error("Ensemble: world index out of range.");
+    }
+    // Until run() the present is returned, afterwards the state the world retired with
+    const uint64_t* group = (finished ? final_state : worlds).data() + (k / 64) * cells;
+    std::vector<uint8_t> map(cells);
+    for (size_t c = 0; c < cells; ++c) {
+        map[c] = (group[c] >> (k % 64)) & 1;
+    }
+    return map;
+}
+
+void Ensemble::evolve(const uint64_t* map, uint64_t* next, int height, int width,
+                      uint64_t& differs_present, uint64_t& differs_past, const uint64_t* past) {
+    uint64_t dp = 0, dq = 0;
+    for (int y = 0; y < height; ++y) {
+        const uint64_t* up = map + (size_t)((y + height - 1) % height) * width;
+        const uint64_t* mid = map + (size_t)y * width;
+        const uint64_t* down = map + (size_t)((y + 1) % height) * width;
+        const uint64_t* old = past + (size_t)y * width;
+        uint64_t* out = next + (size_t)y * width;
+        for (int x = 0; x < width; ++x) {
+            int l = x == 0 ? width - 1 : x - 1;
+            int r = x == width - 1 ? 0 : x + 1;
+
+            // Same adders as BitBoard::evolve_row, the 64 lanes are 64 worlds instead of 64 columns
+            uint64_t aw = up[l], a = up[x], ae = up[r];
+            uint64_t mw = mid[l], m = mid[x], me = mid[r];
+            uint64_t bw = down[l], b = down[x], be = down[r];
+            uint64_t a0 = aw ^ a ^ ae, a1 = (aw & a) | (ae & (aw ^ a));
+            uint64_t b0 = bw ^ b ^ be, b1 = (bw & b) | (be & (bw ^ b));
+            uint64_t m0 = mw ^ me, m1 = mw & me;
+            uint64_t s0 = a0 ^ b0 ^ m0;
+            uint64_t c0 = (a0 & b0) | (m0 & (a0 ^ b0));
+            uint64_t p = a1 ^ b1, z = m1 ^ c0;
+            uint64_t twos_is_one = (p ^ z) & ~((a1 & b1) | (m1 & c0));
+            uint64_t result = twos_is_one & (s0 | m);
+
+            out[x] = result;
+            dp |= result ^ m;
+            dq |= result ^ old[x];
+        }
+    }
+    differs_present = dp;
+    differs_past = dq;
+}
+
+void Ensemble::run_group(size_t g, int max_gens) {
+    const size_t first = g * 64;
+    const int lanes = (int)std::min<size_t>(64, count - first);
+    uint64_t active = lanes == 64 ? ~0ULL : (1ULL << lanes) - 1;
+
+    // The past starts empty, like the past of a new GameOfLife
+    std::vector<uint64_t> buffers[3];
+    buffers[0].assign(cells, 0);
+    buffers[1].assign(worlds.begin() + g * cells, worlds.begin() + (g + 1) * cells);
+    buffers[2].assign(cells, 0);
+    uint64_t *past = buffers[0].data(), *present = buffers[1].data(), *future = buffers[2].data();
+    uint64_t* final = final_state.data() + g * cells;
+
+    uint32_t population[64] = {0};
+    for (size_t c = 0; c < cells; ++c) {
+        for (uint64_t v = present[c]; v; v &= v - 1) {
+            population[__builtin_ctzll(v)]++;
+        }
+    }
+    for (int k = 0; k < lanes; ++k) {
+        stats[first + k].initial_population = population[k];
+    }
+
+    // Writes the state of the lanes that retire (taken from present or future) into final and counts it
+    auto retire = [&](uint64_t from_present, uint64_t from_future, int generations, uint64_t differs_present) {
+        uint32_t pop[64] = {0};
+        for (size_t c = 0; c < cells; ++c) {
+            uint64_t v = (present[c] & from_present) | (future[c] & from_future);
+            final[c] |= v;
+            for (; v; v &= v - 1) {
+                pop[__builtin_ctzll(v)]++;
+            }
+        }
+        for (uint64_t lanes_left = from_present | from_future; lanes_left; lanes_left &= lanes_left - 1) {
+            int k = __builtin_ctzll(lanes_left);
+            bool stable = (from_present >> k) & 1;
+            stats[first + k].generations = generations;
+            stats[first + k].population = pop[k];
+            stats[first + k].stable = stable;
+            stats[first + k].period = stable ? (((differs_present >> k) & 1) ? 2 : 1) : 0;
+        }
+    };
+
+    if (max_gens <= 0) {
+        retire(active, 0, 0, 0);
+        for (int k = 0; k < lanes; ++k) stats[first + k].stable = 0, stats[first + k].period = 0;
+        return;
+    }
+
+    for (int gen = 1; active; ++gen) {
+        uint64_t differs_present, differs_past;
+        evolve(present, future, height, width, differs_present, differs_past, past);
+
+        // A world is stable when its future repeats the present or the past, it keeps its present then
+        uint64_t stable = active & ~(differs_present & differs_past);
+        uint64_t limit = gen == max_gens ? active & ~stable : 0;
+        if (stable | limit) {
+            retire(stable, limit, gen, differs_present);
+            active &= ~(stable | limit);
+        }
+
+        uint64_t* oldest = past;
+        past = present;
+        present = future;
+        future = oldest;
+    }
+}
+
+void Ensemble::run(int max_gens) {
+    std::fill(final_state.begin(), final_state.end(), 0);
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t g = 0; g < groups; ++g) {
+        run_group(g, max_gens);
+    }
+    finished = true;
+}
@@ -0,0 +1,47 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+struct EnsembleStats {
+    uint32_t generations;        // Generations computed, the one that found the world stable included (like get_data())
+    uint32_t initial_population;
+    uint32_t population;         // Live cells when the world retired
+    uint8_t stable;              // 0 when the world was still changing after max_gens
+    uint8_t period;              // 1 for a still life, 2 for period 2, 0 when not stable
+};
+
+/*
++ Many independent B3/S23 worlds of the same size advanced together. The worlds are bit sliced: one
++ uint64_t per cell holds that cell for 64 worlds (bit k is world 64*g + k of group g), so the full adder
++ logic of BitBoard advances 64 worlds per operation without any shifting. Every group runs on its own
++ thread until all of its worlds are stable (same check as is_stable() with the default history) or
++ max_gens is reached. A world that retires keeps its state, the lane keeps running but is ignored.
+*/
+class Ensemble {
+    private:
+        int width = 0, height = 0;
+        size_t count = 0, cells = 0, groups = 0;
+        std::vector<uint64_t> worlds;      // Present of every group, group g at g * cells
+        std::vector<uint64_t> final_state; // State of the retired worlds
+        std::vector<EnsembleStats> stats;
+        bool finished = false;             // get_world() reads final_state once run() is done
+
+        void run_group(size_t g, int max_gens);
+        static void evolve(const uint64_t* map, uint64_t* next, int height, int width,
+                           uint64_t& differs_present, uint64_t& differs_past, const uint64_t* past);
+
+    public:
+        Ensemble(size_t count, int h, int w);
+
+        void randomize(uint64_t seed, double density = 0.5); // World k only depends on seed and k (Seeding.h)
+        void set_world(size_t k, const std::vector<uint8_t>& map);
+        std::vector<uint8_t> get_world(size_t k) const;       // Final state after run()
+        void run(int max_gens);
+        const std::vector<EnsembleStats>& get_stats() const {return stats;}
+        size_t size() const {return count;}
+};
+
+#endif //ENSEMBLE_H
@@ -4,7 +4,6 @@
 
 #include <utility>
 #include <functional>
-#include <atomic>
 #include "../include/GameOfLife.h"
 
 GameOfLife::GameOfLife(int h, int w) : height(h), width(w){
@@ -26,160 +25,758 @@ void GameOfLife::run_simulation(int gens, std::string type) {
     auto start = Clock_t::now();
     auto finish = Clock_t::now();
 
-    if (((height % 10 != 0) || (width % 10 != 0)) && type == "CL") {
-        std::cout << std::endl;
-        std::cout << "====================================================================================" << std::endl;
-        std::cout << "The size of the world does not match the group size to use OpenCL changing to Scalar" << std::endl;
-        std::cout << "====================================================================================" << std::endl;
-        std::cout << std::endl;
-        std::this_thread::sleep_for(std::chrono::milliseconds(3000));
-        type = "scalar";
+    // Loaded worlds can have dying states of a Generations rule that is not the current one
+    check_states();
+
+    // Only these simulations are written for any rule, the others are B3/S23 by construction
+    bool any_rule = type == "scalar" || type == "fused" || type == "omp" || type == "CL" || type == "CL-persistent";
+    // On the unbounded plane B0 would fill the whole plane in one generation
+    any_rule = any_rule || (type == "sparse" && rule.states == 2 && !rule.is_ltl() && !(rule.birth_mask & 1));
+    if (!rule.is_life() && !any_rule) {
+        std::string supported = type == "sparse" ? "two-state B/S rules without B0" : "B3/S23";
+        std::string message = "The simulation " + type + " only supports " + supported + ", changing to fused for " + rule.name;
+        if (headless) {
+            std::cerr << message << std::endl;
+        } else {
+            std::cout << std::endl;
+            std::cout << "====================================================================================" << std::endl;
+            std::cout << message << std::endl;
+            std::cout << "====================================================================================" << std::endl;
+            std::cout << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(3000));
+        }
+        type = "fused";
     }
+    bool specialized = false;
+    rule_kernel = select_rule_kernel(rule, specialized);
+    if (debug) {
+        std::cout << "Rule " << rule.name << (specialized ? " (specialized kernel)" : " (generic kernel)") << std::endl;
+    }
+
+    engine_used = type;
+    stopped_stable = false;
+    plane_edge = false;
+    generations_run = 0;
+
+    start_checkpoints();
+    if (type == "hashlife") {
+        run_hashlife(gens);
+        finish_checkpoints();
+        return;
+    }
+    if (type == "distributed") {
+        run_distributed(gens);
+        // Like the other engines present stays at the generation before the one that turned out to be stable
+        world_generation += generations_run - (stopped_stable ? 1 : 0);
+        finish_checkpoints();
+        return;
+    }
+
+    PROFILE_SCOPE("run_simulation");
 
     std::function<void()> evolve_func;
     std::function<bool()> compare_func;
+    // Moves the generations one step back, engines with their own storage replace it
+    std::function<void()> rotate_func = [this]() { rotate_history(); };
+    // Writes the state of the engine back into past and present (for print(), checkpoints and after the run)
+    std::function<void()> sync_func = []() {};
+    // Generations one call of evolve_func advances, the last call only does what is left
+    int step = 1;
+    // Generations the last evolve_func and compare_func covered, fewer than step when a batch turned out stable early
+    int advanced = 1;
+    // The engine fills step_births/step_deaths in evolve_func, otherwise the population is counted after the run
+    bool counts_changes = track_statistics;
+    int i = 0;
+
+    ScopedTimer setup_timer("setup");
     if (type == "CL") {
         setupOpenCL();
-        evolve_func = [this]() { evolve_opencl(); };
+        evolve_func = [this]() {
+            evolve_opencl();
+            if (track_statistics) {
+                count_changes(present.data(), future.data(), w_size, step_births, step_deaths);
+            }
+        };
         compare_func = [this]() { return compare_cl(); };
+    } else if (type == "CL-persistent") {
+        setupOpenCL();
+        setup_resident_cl();
+        // The batch after the current one is queued before the host waits for the flags of the current one,
+        // so the device always has the next batch to compute; it is thrown away when the current one is stable
+        step = std::max(1, cl_batch);
+        evolve_func = [this, &i, &step, gens]() {
+            if (cl_queued == cl_checked) {
+                queue_resident_cl(std::min(step, gens - i));
+            }
+            if (i + step < gens) {
+                queue_resident_cl(std::min(step, gens - i - step));
+            }
+        };
+        compare_func = [this, &advanced]() {
+            int first = compare_resident_cl();
+            if (first < 0) {
+                return false;
+            }
+            // Like the other engines the run stops at the first stable generation, present is the one before it
+            advanced = first + 1;
+            world_generation += first;
+            return true;
+        };
+        rotate_func = []() {}; // compare_resident_cl() already moved cl_present and cl_past
+        sync_func = [this]() { read_resident_cl(); };
+        counts_changes = false; // The generations stay on the device
+    } else if (type == "bitpacked") {
+        bit_past = BitBoard(height, width);
+        bit_present = BitBoard(height, width);
+        bit_future = BitBoard(height, width);
+        bit_past.pack(past);
+        bit_present.pack(present);
+        evolve_func = [this]() {
+            bit_present.evolve(bit_future);
+            if (track_statistics) {
+                bit_present.count_changes(bit_future, step_births, step_deaths);
+            }
+        };
+        compare_func = [this]() { return bit_present == bit_future || bit_past == bit_future; };
+        rotate_func = [this]() {
+            std::swap(bit_past, bit_present);
+            std::swap(bit_present, bit_future);
+        };
+        sync_func = [this]() {
+            bit_past.unpack(past);
+            bit_present.unpack(present);
+        };
+    } else if (type == "omp") {
+        setup_bands();
+        evolve_func = [this]() { evolve_omp(); };
+        if (rule.is_ltl()) {
+            evolve_func = [this]() {
+                evolve_ltl(band_present.get(), band_future.get(), height, width, rule);
+                if (track_statistics) {
+                    count_changes(band_present.get(), band_future.get(), w_size, step_births, step_deaths);
+                }
+            };
+        }
+        compare_func = [this]() { return is_stable_omp(); };
+        rotate_func = [this]() {
+            band_past.swap(band_present);
+            band_present.swap(band_future);
+        };
+        sync_func = [this]() {
+            std::copy(band_past.get(), band_past.get() + w_size, past.begin());
+            std::copy(band_present.get(), band_present.get() + w_size, present.begin());
+        };
+    } else if (type == "simd") {
+        std::string name;
+        SimdRowKernel kernel = select_simd_kernel(simd_isa, name);
+        if (debug) {
+            std::cout << "Using the " << name << " kernel" << std::endl;
+        }
+        evolve_func = [this, kernel]() { evolve_simd(kernel); };
+        compare_func = [this]() { return is_stable(); };
+    } else if (type == "tiled") {
+        tiled = TiledEngine(height, width, tile_size, period_window);
+        tiled.load(past, present);
+        tile_activity.clear();
+        evolve_func = [this]() {
+            tiled.evolve();
+            step_births = tiled.get_births();
+            step_deaths = tiled.get_deaths();
+            tile_activity.push_back(tiled.get_active_fraction());
+            PROFILE_COUNT("active tiles", tile_activity.back());
+        };
+        compare_func = [this]() {
+            bool stable = tiled.is_stable();
+            if (stable && debug) {
+                std::cout << "Period " << tiled.get_period() << " detected" << std::endl;
+            }
+            return stable;
+        };
+        rotate_func = [this]() { tiled.rotate(); };
+        sync_func = [this]() { tiled.store(past, present); };
+    } else if (type == "temporal") {
+        step = std::max(1, temporal_k);
+        evolve_func = [this, &i, &step, gens]() {
+            advance_blocked(present.data(), future.data(), height, width, temporal_tile, std::min(step, gens - i));
+            if (track_statistics) {
+                count_changes(present.data(), future.data(), w_size, step_births, step_deaths); // Net over the step
+            }
+        };
+        // The generations in the history are step apart, so this finds periods that divide step or 2*step
+        compare_func = [this]() { return is_stable(); };
+    } else if (type == "sparse") {
+        sparse.set_rule(rule.birth_mask, rule.survive_mask);
+        sparse.import_world(past, present, height, width);
+        auto outside = [this]() {
+            int64_t x0, y0, x1, y1;
+            return sparse.get_bounds(x0, y0, x1, y1) && (x0 < 1 || y0 < 1 || x1 > width - 2 || y1 > height - 2);
+        };
+        check_plane_edge(outside());
+        evolve_func = [this]() {
+            sparse.evolve();
+            step_births = sparse.get_births();
+            step_deaths = sparse.get_deaths();
+        };
+        compare_func = [this]() { return sparse.is_stable(); };
+        rotate_func = [this, outside]() {
+            sparse.rotate();
+            if (!plane_edge) {
+                check_plane_edge(outside());
+            }
+        };
+        // Cells outside of the window are dropped, the statistics count the whole plane
+        sync_func = [this]() { sparse.export_world(past, present, height, width); };
+    } else if (type == "fused") {
+        evolve_func = [this]() { evolve_fused(present, future); };
+        if (rule.is_ltl()) {
+            evolve_func = [this]() {
+                evolve_ltl(present.data(), future.data(), height, width, rule);
+                if (track_statistics) {
+                    count_changes(present.data(), future.data(), w_size, step_births, step_deaths);
+                }
+            };
+        }
+        compare_func = [this]() { return is_stable(); };
     } else {
         evolve_func = [this]() {
-            std::vector<uint8_t> neighbors = count_neighbors(present);
+            std::vector<uint8_t> neighbors;
+            {
+                PROFILE_SCOPE("count_neighbors");
+                neighbors = count_neighbors(present);
+            }
+            PROFILE_SCOPE("apply_rule");
             evolve(present, future, neighbors);
         };
+        if (rule.is_ltl()) {
+            evolve_func = [this]() {
+                evolve_ltl(present.data(), future.data(), height, width, rule);
+                if (track_statistics) {
+                    count_changes(present.data(), future.data(), w_size, step_births, step_deaths);
+                }
+            };
+        }
         compare_func = [this]() { return is_stable(); };
     }
+    setup_timer.stop();
 
-    for (int i = 0; i < gens; ++i) {
-        if (print_enable) {
-            print();
-            std::this_thread::sleep_for(std::chrono::milliseconds(print_delay_ms));
+    bool rendering = print_enable && !headless;
+    if (rendering) {
+        renderer.start(print_delay_ms);
+    }
+    for (; i < gens; i += step) {
+        // Only the generations the renderer is ready for are written back, the others are not drawn
+        if (rendering && renderer.wants_frame()) {
+            PROFILE_SCOPE("print");
+            sync_func();
+            if (!counts_changes) {
+                recount_population();
+            }
+            renderer.submit(present, height, width, generations_run, population);
         }
         
         start = Clock_t::now();
-        evolve_func();
-
-        if (compare_func()) {
-            std::cout << "The system is stable and the simulation has been stopped" << std::endl;
-            break;
+        step_births = step_deaths = 0;
+        advanced = std::min(step, gens - i);
+        {
+            PROFILE_SCOPE("evolve");
+            evolve_func();
+        }
+        bool stable;
+        {
+            PROFILE_SCOPE("compare");
+            stable = compare_func();
         }
         finish = Clock_t::now();
+        generations_run += advanced;
 
+        // The generation that turned out to be stable is also recorded
         data.push_back(finish - start);
+        data_generations.push_back(advanced);
+        size_t next_population = population + step_births - step_deaths;
+        if (counts_changes) {
+            generation_stats.push_back({generations_run, next_population, step_births, step_deaths});
+        }
+        if (stable) {
+            stopped_stable = true;
+            std::cout << "The system is stable and the simulation has been stopped" << std::endl;
+            break;
+        }
         // Assign new values to compare later
-        past = present;
-        present = future;
+        {
+            PROFILE_SCOPE("rotate");
+            rotate_func();
+            population = next_population;
+            world_generation += advanced;
+        }
+        // Only a copy is taken here, when the last checkpoint is still being written it is taken a generation later
+        if (!checkpoint_path.empty() && checkpoints.ready() && checkpoint_due()) {
+            PROFILE_SCOPE("checkpoint");
+            sync_func();
+            take_checkpoint(false);
+        }
 
         if (debug) {
             std::cout << "starting " << i << " generation" << std::endl;
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
     }
+    {
+        PROFILE_SCOPE("sync");
+        sync_func();
+    }
+    if (!counts_changes || type == "sparse") {
+        recount_population();
+    }
+    finish_checkpoints();
+    if (rendering) {
+        renderer.finish(present, height, width, generations_run, population);
+    }
+
+    if (type == "CL-persistent") {
+        release_resident_cl();
+    }
+}
+
+
+void GameOfLife::run_hashlife(int gens) {
+    /*
+    + Hashlife does not step one generation at a time, gens is split into powers of two and every jump is
+    + one entry in data. The stability check is done per jump (the world did not change during the jump).
+    */
+    auto start = Clock_t::now();
+    auto finish = Clock_t::now();
+
+    bool rendering = print_enable && !headless;
+    if (rendering) {
+        renderer.start(print_delay_ms);
+    }
+    hashlife.import_world(present, height, width);
+    // Checked after every jump, a pattern that touches the edge and comes back within one jump is not seen
+    auto check_edge = [this]() {
+        check_plane_edge(hashlife.get_population(1, 1, width - 1, height - 1) != hashlife.get_population());
+    };
+    check_edge();
+    for (int k = 30; k >= 0; --k) {
+        if (!(gens & (1 << k))) {
+            continue;
+        }
+        if (rendering && renderer.wants_frame()) {
+            hashlife.export_world(present, height, width);
+            renderer.submit(present, height, width, generations_run, hashlife.get_population());
+        }
+
+        start = Clock_t::now();
+        {
+            PROFILE_SCOPE("advance_pow2");
+            hashlife.advance_pow2(k);
+        }
+        finish = Clock_t::now();
+        data.push_back(finish - start);
+        data_generations.push_back((uint32_t)1 << k);
+        generations_run += (uint64_t)1 << k;
+        world_generation += (uint64_t)1 << k;
+        PROFILE_COUNT("hashlife nodes", hashlife.get_node_count());
+        if (!plane_edge) {
+            check_edge();
+        }
+
+        if (debug) {
+            std::cout << "generation " << hashlife.get_generation() << ", " << hashlife.get_node_count() << " nodes" << std::endl;
+        }
+        if (hashlife.is_unchanged()) {
+            stopped_stable = true;
+            std::cout << "The system is stable and the simulation has been stopped" << std::endl;
+            break;
+        }
+        if (!checkpoint_path.empty() && checkpoints.ready() && checkpoint_due()) {
+            // hashlife keeps no older generation, a resumed run finds a period of 2 one generation later
+            hashlife.export_world(present, height, width);
+            past = present;
+            take_checkpoint(false);
+        }
+    }
+    hashlife.export_world(present, height, width);
+    past = present;
+    recount_population();
+    if (rendering) {
+        renderer.finish(present, height, width, generations_run, population);
+    }
+}
+
+void GameOfLife::check_plane_edge(bool outside) {
+    /*
+    + hashlife and sparse run on the unbounded plane. As long as the live cells stay away from the edge of the
+    + window the result is the one of the torus, once they reach it they would wrap around on the torus.
+    */
+    if (outside && !plane_edge) {
+        plane_edge = true;
+        std::cout << "The world reached the edge of the window, " << engine_used << " runs on the unbounded plane and from here on differs from the torus" << std::endl;
+    }
 }
 
+void GameOfLife::run_distributed(int gens) {
+    /*
+    + The ranks are separate processes, so the world is only back in present after the whole run and it
+    + can not be displayed in between. The stability check is the one of scalar with the default history.
+    */
+    PROFILE_SCOPE("run_distributed");
+    DistributedEngine engine(height, width, ranks);
+    if (debug) {
+        std::cout << "Running on " << engine.get_ranks() << " ranks (" << engine.get_grid_y() << "x" << engine.get_grid_x() << " blocks)" << std::endl;
+    }
+
+    std::vector<double> times;
+    bool stable = engine.run(past, present, gens, times);
+    for (double t : times) {
+        data.push_back(std::chrono::duration<double>(t));
+        data_generations.push_back(1);
+    }
+    generations_run = times.size();
+    reset_history();
+    recount_population();
+    if (stable) {
+        stopped_stable = true;
+        std::cout << "The system is stable and the simulation has been stopped" << std::endl;
+    }
+}
 
 void GameOfLife::evolve_opencl(){
     cl_int err;
+    cl_int zero = 0;
 
-    // Creates the buffers
+    // Creates the buffers, the copies of the host pointers are the upload of present and past
+    ScopedTimer upload_timer("upload generations");
     cl_mem bufferMap = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(uint8_t)*w_size, present.data(), &err);
     checkError(err, "clCreateBuffer (bufferMap)");
+    cl_mem bufferOlder = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(uint8_t)*w_size, past.data(), &err);
+    checkError(err, "clCreateBuffer (bufferOlder)");
     cl_mem bufferNext = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(uint8_t)*w_size, nullptr, &err);
     checkError(err, "clCreateBuffer (bufferNext)");
+    cl_mem bufferFlags = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_int), &zero, &err);
+    checkError(err, "clCreateBuffer (bufferFlags)");
+    upload_timer.stop();
 
-    // Set the arguments for the evolve_kernel function
-    err = clSetKernelArg(evolve_kernel, 0, sizeof(cl_mem), &bufferMap);
-    checkError(err, "Kernel Arg map: ");
-    err = clSetKernelArg(evolve_kernel, 1, sizeof(cl_mem), &bufferNext);
-    checkError(err, "Kernel Arg future: ");
-    // OMFG how are we supposed to know that size_t as other types are not supported by Kernel??
-    err = clSetKernelArg(evolve_kernel, 2, sizeof(int), &width);
-    checkError(err, "Kernel Arg width: ");
-    err = clSetKernelArg(evolve_kernel, 3, sizeof(int), &height);
-    checkError(err, "Kernel Arg height: ");
-
-    // Specifies the global and local work sizes
-    size_t global_work_size[2] = {(size_t)width, (size_t)height};
-    size_t local_work_size[2] = {10, 10};
-
-    // Queues the evolve_kernel and then reads the data back to the future array
-    err = clEnqueueNDRangeKernel(queue, evolve_kernel, 2, nullptr, global_work_size, local_work_size, 0, nullptr, nullptr);
-    checkError(err, "clEnqueueNDRangeKernel");
-    err = clEnqueueReadBuffer(queue, bufferNext, CL_TRUE, 0, sizeof(uint8_t)*w_size, future.data(), 0, nullptr, nullptr);
+    // The evolve_kernel also compares the new generation, the queue is in order so only the last read blocks
+    enqueue_evolve(bufferMap, bufferOlder, bufferNext, bufferFlags, 0);
+    err = clEnqueueReadBuffer(queue, bufferNext, CL_FALSE, 0, sizeof(uint8_t)*w_size, future.data(), 0, nullptr, profile_event("read future"));
     checkError(err, "clEnqueueReadBuffer");
+    err = clEnqueueReadBuffer(queue, bufferFlags, CL_TRUE, 0, sizeof(cl_int), &cl_changed, 0, nullptr, profile_event("read flags"));
+    checkError(err, "clEnqueueReadBuffer (bufferFlags)");
+    collect_cl_events();
 
     // Release the buffer
     clReleaseMemObject(bufferMap);
+    clReleaseMemObject(bufferOlder);
     clReleaseMemObject(bufferNext);
+    clReleaseMemObject(bufferFlags);
 }
 
 bool GameOfLife::compare_cl(){
+    // The flags were computed by the evolve_kernel: bit 0 future differs from present, bit 1 from past
+    return (cl_changed & 1) == 0 || (cl_changed & 2) == 0;
+}
+
+void GameOfLife::setup_resident_cl() {
     cl_int err;
-    bool result = true;
-
-    // Set the work batch sizes
-    size_t global_work_size[1] = {(size_t)w_size};
-    size_t local_work_size[1] = {10};
-
-    // Creates Buffers
-    cl_mem buffer_past = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(uint8_t)*w_size, past.data(), &err);
-    checkError(err, "clCreateBuffer (buffer_past comparison)");
-    cl_mem buffer_present = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(uint8_t)*w_size, present.data(), &err);
-    checkError(err, "clCreateBuffer (buffer_present comparison)");
-    cl_mem buffer_future = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(uint8_t)*w_size, future.data(), &err);
-    checkError(err, "clCreateBuffer (buffer_future comparison)");
-    cl_mem buffer_result = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(bool), nullptr, &err);
-    checkError(err, "clCreateBuffer (buffer_result comparison)");
-
-    // Set Arguments
-    err = clSetKernelArg(compare_kernel, 0, sizeof(cl_mem), &buffer_present);
-    checkError(err, "Kernel Arg::compare::present: ");
-    err = clSetKernelArg(compare_kernel, 1, sizeof(cl_mem), &buffer_future);
-    checkError(err, "Kernel Arg::compare::future: ");
-    err = clSetKernelArg(compare_kernel, 2, sizeof(cl_mem), &buffer_result);
-    checkError(err, "Kernel Arg::compare::result: ");
-
-    // Compare n to n-1 generation
-    err = clEnqueueNDRangeKernel(queue, compare_kernel, 1, nullptr, global_work_size, local_work_size, 0, nullptr, nullptr);
-    checkError(err, "clEnqueueNDRangeKernel comparison::function1");
-    err = clEnqueueReadBuffer(queue, buffer_result, CL_TRUE, 0, sizeof(bool), &result, 0, nullptr, nullptr);
-    checkError(err, "clEnqueueNDRangeKernel comparison::function::writeback1");
-    clReleaseMemObject(buffer_present);
-    
-    //compare n to the n-2 generation
-    err = clSetKernelArg(compare_kernel, 0, sizeof(cl_mem), &buffer_past);
-    checkError(err, "Kernel Arg::compare::present: ");
-    err = clSetKernelArg(compare_kernel, 1, sizeof(cl_mem), &buffer_future);
-    checkError(err, "Kernel Arg::compare::future: ");
-    err = clSetKernelArg(compare_kernel, 2, sizeof(cl_mem), &buffer_result);
-    checkError(err, "Kernel Arg::compare::result: ");
-    err = clEnqueueNDRangeKernel(queue, compare_kernel, 1, nullptr, global_work_size, local_work_size, 0, nullptr, nullptr);
-    checkError(err, "clEnqueueNDRangeKernel comparison::function2");
-    
-    err = clEnqueueReadBuffer(queue, buffer_result, CL_TRUE, 0, sizeof(bool), &result, 0, nullptr, nullptr);
-    checkError(err, "clEnqueueNDRangeKernel comparison::function::writeback2");
 
-    // Free memory
-    clReleaseMemObject(buffer_past);
-    clReleaseMemObject(buffer_future);
-    clReleaseMemObject(buffer_result);
+    // The history is uploaded once, afterwards it only lives on the device
+    for (cl_mem& buffer : cl_history) {
+        buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(uint8_t)*w_size, nullptr, &err);
+        checkError(err, "clCreateBuffer (cl_history)");
+    }
+    for (ResidentBatch& batch : cl_batches) {
+        batch.flags = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_int)*std::max(1, cl_batch), nullptr, &err);
+        checkError(err, "clCreateBuffer (flags)");
+        batch.changed.assign(std::max(1, cl_batch), 0);
+        batch.ready = nullptr;
+        batch.gens = 0;
+    }
 
-    return result;
+    // The uploaded generations are the end of the batch before the first one
+    cl_present = cl_history[0];
+    cl_past = cl_history[1];
+    cl_batches[1].present = cl_present;
+    cl_batches[1].past = cl_past;
+    cl_queued = cl_checked = 0;
+    err = clEnqueueWriteBuffer(queue, cl_present, CL_FALSE, 0, sizeof(uint8_t)*w_size, present.data(), 0, nullptr, nullptr);
+    checkError(err, "clEnqueueWriteBuffer (present)");
+    err = clEnqueueWriteBuffer(queue, cl_past, CL_TRUE, 0, sizeof(uint8_t)*w_size, past.data(), 0, nullptr, nullptr);
+    checkError(err, "clEnqueueWriteBuffer (past)");
+}
+
+void GameOfLife::queue_resident_cl(int gens) {
+    cl_int err;
+    ResidentBatch& before = cl_batches[(cl_queued + 1) % 2];
+    ResidentBatch& batch = cl_batches[cl_queued % 2];
+
+    // The generations are queued back to back and nothing waits for them, every one ORs into its own flags
+    err = clEnqueueFillBuffer(queue, batch.flags, &cl_zero, sizeof(cl_int), 0, sizeof(cl_int)*gens, 0, nullptr, nullptr);
+    checkError(err, "clEnqueueFillBuffer (flags)");
+    // The end of the batch before stays untouched, the host reads it when that batch turns out stable
+    const cl_mem kept[2] = {before.present, before.past};
+    cl_mem map = before.present, older = before.past;
+    for (int g = 0; g < gens; ++g) {
+        cl_mem next = nullptr;
+        for (cl_mem buffer : cl_history) {
+            if (buffer != map && buffer != older && buffer != kept[0] && buffer != kept[1]) {
+                next = buffer;
+                break;
+            }
+        }
+        enqueue_evolve(map, older, next, batch.flags, g);
+        older = map;
+        map = next;
+    }
+    batch.present = map;
+    batch.past = older;
+    batch.gens = gens;
+
+    cl_event* event = profile_event("read flags");
+    err = clEnqueueReadBuffer(queue, batch.flags, CL_FALSE, 0, sizeof(cl_int)*gens, batch.changed.data(), 0, nullptr, event ? event : &batch.ready);
+    checkError(err, "clEnqueueReadBuffer (flags)");
+    if (event) {
+        batch.ready = *event; // Released by collect_cl_events()
+    }
+    batch.events = cl_events.size();
+    clFlush(queue);
+    cl_queued++;
+}
+
+int GameOfLife::compare_resident_cl() {
+    ResidentBatch& batch = cl_batches[cl_checked % 2];
+    cl_checked++;
+
+    // The only time the host waits for the device in a batch, the next batch is already queued behind it
+    cl_int err = clWaitForEvents(1, &batch.ready);
+    checkError(err, "clWaitForEvents (flags)");
+    if (!Profiler::get().enabled()) {
+        clReleaseEvent(batch.ready);
+    }
+    batch.ready = nullptr;
+    // Only the events up to the read of these flags have finished, the next batch collects its own
+    collect_cl_events(batch.events);
+    ResidentBatch& next = cl_batches[cl_checked % 2];
+    next.events -= std::min(next.events, batch.events);
+
+    int first = -1;
+    for (int g = 0; g < batch.gens && first < 0; ++g) {
+        if ((batch.changed[g] & 1) == 0 || (batch.changed[g] & 2) == 0) {
+            first = g;
+        }
+    }
+    cl_present = batch.present;
+    cl_past = batch.past;
+    if (first >= 0 && (batch.gens - first) % 2 == 1) {
+        // From the stable generation on the world repeats every one or two generations, so the generation
+        // before it is the end of the batch when they are an even number of generations apart, otherwise
+        // the one before the end
+        std::swap(cl_present, cl_past);
+    }
+    if (first == 0 && cl_checked == 1) {
+        // The uploaded past is no predecessor of present (all dead for a new world), a world that dies in its
+        // first generation does not repeat. The host still has both, the batch queued after this one may
+        // already overwrite the uploaded buffers but never the end of this batch
+        cl_int err = clEnqueueWriteBuffer(queue, cl_present, CL_FALSE, 0, sizeof(uint8_t)*w_size, present.data(), 0, nullptr, nullptr);
+        checkError(err, "clEnqueueWriteBuffer (present)");
+        err = clEnqueueWriteBuffer(queue, cl_past, CL_TRUE, 0, sizeof(uint8_t)*w_size, past.data(), 0, nullptr, nullptr);
+        checkError(err, "clEnqueueWriteBuffer (past)");
+    }
+    return first;
+}
+
+void GameOfLife::enqueue_evolve(cl_mem map, cl_mem older, cl_mem next, cl_mem flags, int check) {
+    cl_int err;
+    err = clSetKernelArg(evolve_kernel, 0, sizeof(cl_mem), &map);
+    checkError(err, "Kernel Arg map: ");
+    err = clSetKernelArg(evolve_kernel, 1, sizeof(cl_mem), &older);
+    checkError(err, "Kernel Arg older: ");
+    err = clSetKernelArg(evolve_kernel, 2, sizeof(cl_mem), &next);
+    checkError(err, "Kernel Arg future: ");
+    // OMFG how are we supposed to know that size_t as other types are not supported by Kernel??
+    err = clSetKernelArg(evolve_kernel, 3, sizeof(int), &width);
+    checkError(err, "Kernel Arg width: ");
+    err = clSetKernelArg(evolve_kernel, 4, sizeof(int), &height);
+    checkError(err, "Kernel Arg height: ");
+    err = clSetKernelArg(evolve_kernel, 5, sizeof(cl_mem), &flags);
+    checkError(err, "Kernel Arg flags: ");
+    err = clSetKernelArg(evolve_kernel, 6, sizeof(int), &check);
+    checkError(err, "Kernel Arg check: ");
+
+    // Whole groups, the kernel skips the cells past the right and bottom edge
+    size_t span = (size_t)cl_shape[0] * cl_shape[2];
+    size_t global_work_size[2] = {(width + span - 1) / span * cl_shape[0], ((size_t)height + cl_shape[1] - 1) / cl_shape[1] * cl_shape[1]};
+    size_t local_work_size[2] = {(size_t)cl_shape[0], (size_t)cl_shape[1]};
+    err = clEnqueueNDRangeKernel(queue, evolve_kernel, 2, nullptr, global_work_size, local_work_size, 0, nullptr, profile_event("evolve kernel"));
+    checkError(err, "clEnqueueNDRangeKernel");
+}
+
+void GameOfLife::read_resident_cl() {
+    // Only called when the host needs the world (display, checkpoints, end of the run)
+    // The batch that is still running never writes these two buffers
+    cl_int err = clEnqueueReadBuffer(queue, cl_present, CL_TRUE, 0, sizeof(uint8_t)*w_size, present.data(), 0, nullptr, nullptr);
+    checkError(err, "clEnqueueReadBuffer (present)");
+    err = clEnqueueReadBuffer(queue, cl_past, CL_TRUE, 0, sizeof(uint8_t)*w_size, past.data(), 0, nullptr, nullptr);
+    checkError(err, "clEnqueueReadBuffer (past)");
+}
+
+cl_event* GameOfLife::profile_event(const char* name) {
+    // Without profiling the commands do not create events at all
+    if (!Profiler::get().enabled()) {
+        return nullptr;
+    }
+    cl_events.push_back({nullptr, name});
+    return &cl_events.back().first;
+}
+
+void GameOfLife::collect_cl_events(size_t count) {
+    // Called after a blocking command, the in-order queue guarantees that every event before it has finished
+    count = std::min(count, cl_events.size());
+    if (count == 0) {
+        return;
+    }
+    auto completed_at = Clock_t::now();
+    for (size_t k = 0; k < count; ++k) {
+        auto& [event, name] = cl_events[k];
+        cl_ulong started = 0, ended = 0;
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &started, nullptr);
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &ended, nullptr);
+        Profiler::get().record_device(name, started, ended, completed_at);
+        clReleaseEvent(event);
+    }
+    cl_events.erase(cl_events.begin(), cl_events.begin() + count);
+}
+
+void GameOfLife::release_resident_cl() {
+    // A batch that was thrown away can still be running and write into the flags of its host copy
+    clFinish(queue);
+    for (ResidentBatch& batch : cl_batches) {
+        if (batch.ready && !Profiler::get().enabled()) {
+            clReleaseEvent(batch.ready);
+        }
+        batch.ready = nullptr;
+        clReleaseMemObject(batch.flags);
+        batch.flags = nullptr;
+    }
+    collect_cl_events();
+    for (cl_mem& buffer : cl_history) {
+        clReleaseMemObject(buffer);
+        buffer = nullptr;
+    }
+    cl_present = cl_past = nullptr;
 }
 
 void GameOfLife::evolve(std::vector<uint8_t>& map, std::vector<uint8_t>& next, std::vector<uint8_t>& neighbors) {
-    std::transform(map.begin(), map.end(), neighbors.begin(), next.begin(), [](uint8_t live, uint8_t n) {
-        if (live == 1) {
-            return (n == 2 || n == 3) ? static_cast<uint8_t>(1) : static_cast<uint8_t>(0); 
+    if (!rule.is_life()) {
+        std::transform(map.begin(), map.end(), neighbors.begin(), next.begin(), [this](uint8_t cell, uint8_t n) {
+            return rule.next_state(cell, n);
+        });
+    } else {
+        std::transform(map.begin(), map.end(), neighbors.begin(), next.begin(), [](uint8_t live, uint8_t n) {
+            if (live == 1) {
+                return (n == 2 || n == 3) ? static_cast<uint8_t>(1) : static_cast<uint8_t>(0); 
+            }
+            return (n == 3) ? static_cast<uint8_t>(1) : static_cast<uint8_t>(0);
+        });
+    }
+    if (track_statistics) {
+        count_changes(map.data(), next.data(), w_size, step_births, step_deaths);
+    }
+}
+
+void GameOfLife::evolve_fused(const std::vector<uint8_t>& map, std::vector<uint8_t>& next) {
+    // One streaming pass over three rows, the toroidal wrap only costs an index calculation per row
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* up = map.data() + (size_t)((y + height - 1) % height) * width;
+        const uint8_t* mid = map.data() + (size_t)y * width;
+        const uint8_t* down = map.data() + (size_t)((y + 1) % height) * width;
+        uint8_t* out = next.data() + (size_t)y * width;
+        evolve_row(up, mid, down, out);
+        if (track_statistics) {
+            count_changes(mid, out, width, step_births, step_deaths); // The row is still in L1
+        }
+    }
+}
+
+void GameOfLife::evolve_row(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out) const {
+    rule_kernel(up, mid, down, out, width, 0, width, rule);
+}
+
+void GameOfLife::evolve_simd(SimdRowKernel kernel) {
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* up = present.data() + (size_t)((y + height - 1) % height) * width;
+        const uint8_t* mid = present.data() + (size_t)y * width;
+        const uint8_t* down = present.data() + (size_t)((y + 1) % height) * width;
+        uint8_t* out = future.data() + (size_t)y * width;
+        kernel(up, mid, down, out, width);
+        if (track_statistics) {
+            count_changes(mid, out, width, step_births, step_deaths);
+        }
+    }
+}
+
+void GameOfLife::set_schedule(const std::string& kind, int chunk) {
+    omp_schedule = (kind == "dynamic") ? omp_sched_dynamic : omp_sched_static;
+    omp_chunk = chunk;
+}
+
+void GameOfLife::setup_bands() {
+    /*
+    + new[] does not touch the memory, so each page is placed on the NUMA node of the thread that writes it
+    + first. The bands are initialized with the same schedule that is used by evolve_omp() afterwards.
+    */
+    band_past.reset(new uint8_t[w_size]);
+    band_present.reset(new uint8_t[w_size]);
+    band_future.reset(new uint8_t[w_size]);
+
+    omp_set_schedule(omp_schedule, omp_chunk);
+    #pragma omp parallel for schedule(runtime)
+    for (int y = 0; y < height; ++y) {
+        size_t row = (size_t)y * width;
+        std::copy(past.begin() + row, past.begin() + row + width, band_past.get() + row);
+        std::copy(present.begin() + row, present.begin() + row + width, band_present.get() + row);
+        std::fill(band_future.get() + row, band_future.get() + row + width, 0);
+    }
+}
+
+void GameOfLife::evolve_omp() {
+    // Each thread works on a band of rows, the halo rows above and below a band are read from the shared map
+    const uint8_t* map = band_present.get();
+    uint8_t* next = band_future.get();
+    size_t births = 0, deaths = 0;
+    #pragma omp parallel for schedule(runtime) reduction(+:births, deaths)
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* up = map + (size_t)((y + height - 1) % height) * width;
+        const uint8_t* mid = map + (size_t)y * width;
+        const uint8_t* down = map + (size_t)((y + 1) % height) * width;
+        uint8_t* out = next + (size_t)y * width;
+        evolve_row(up, mid, down, out);
+        if (track_statistics) {
+            count_changes(mid, out, width, births, deaths);
         }
-        return (n == 3) ? static_cast<uint8_t>(1) : static_cast<uint8_t>(0);
-    });
+    }
+    step_births = births;
+    step_deaths = deaths;
 }
 
+bool GameOfLife::is_stable_omp() {
+    // Both comparisons are done in one pass with the same bands the rows were computed with
+    bool same_present = true, same_past = true;
+    const uint8_t* pa = band_past.get();
+    const uint8_t* pr = band_present.get();
+    const uint8_t* fu = band_future.get();
+    #pragma omp parallel for schedule(runtime) reduction(&&:same_present, same_past)
+    for (int y = 0; y < height; ++y) {
+        size_t row = (size_t)y * width;
+        same_present = same_present && std::equal(pr + row, pr + row + width, fu + row);
+        same_past = same_past && std::equal(pa + row, pa + row + width, fu + row);
+    }
+    return same_present || same_past;
+}
 
 std::vector<uint8_t> GameOfLife::count_neighbors(const std::vector<uint8_t>& vec) {
     // Initialize vector to store the results
     std::vector<uint8_t> result;
+    result.reserve(w_size);
 
     // Calculates the state of the 8 neighbors around each cell
     for (int i = 0; i < height; ++i) {
@@ -233,80 +830,173 @@ void GameOfLife::setupOpenCL(){
 
     // OpenCL devices configuration
     cl_uint deviceCount;
-    cl_device_id device;
     err = clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 1, &device, &deviceCount);
     checkError(err, "clGetDeviceIDs");
     
     // Assigning the context and the queue for said context
     this->context = clCreateContext(nullptr, 1, &device, nullptr, nullptr, &err);
     checkError(err, "clCreateContext");
-    this->queue = clCreateCommandQueue(context, device, 0, &err);
+    // Timestamps of the commands are only recorded when they are wanted, profiling can slow the queue down
+    cl_command_queue_properties properties = Profiler::get().enabled() ? CL_QUEUE_PROFILING_ENABLE : 0;
+    this->queue = clCreateCommandQueue(context, device, properties, &err);
     checkError(err, "clCreateCommandQueue");
 
-    // Get the path to the evolve_kernel
-    std::string path = readKernelSource("evolution.cl");
-    const char *source = path.c_str();
+    // The evolve_kernel is generated for the rule and the work-group shape
+    build_evolve_kernel();
+}
 
-    // Assign the program to the context with the gathered evolve_kernel function
-    this->program = clCreateProgramWithSource(context, 1, &source, nullptr, &err);
-    checkError(err, "clCreateProgramWithSource");
+void GameOfLife::build_evolve_kernel() {
+    cl_int err;
+    size_t max_group = 1;
+    cl_ulong local_memory = 0;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(max_group), &max_group, nullptr);
+    clGetDeviceInfo(device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(local_memory), &local_memory, nullptr);
+
+    int x = std::max(1, cl_group[0]), y = std::max(1, cl_group[1]), cells = std::max(1, cl_group[2]);
+    while (true) {
+        // Halving y first keeps the rows of a group long, which is what makes the loads coalesce
+        size_t tile = (size_t)(x * cells + 2 * rule.range) * (y + 2 * rule.range);
+        if ((size_t)x * y > max_group) {
+            if (y > 1) {
+                y /= 2;
+            } else {
+                x /= 2;
+            }
+            continue;
+        }
+        if (tile > local_memory) {
+            if (x == 1 && y == 1 && cells == 1) {
+                std::cerr << "Error during operation 'build_evolve_kernel': the range " << rule.range << " does not fit into local memory" << std::endl;
+                exit(1);
+            }
+            if (cells > 1) {
+                cells /= 2;
+            } else if (y > 1) {
+                y /= 2;
+            } else {
+                x /= 2;
+            }
+            continue;
+        }
 
-    // Creates the program
-    err = clBuildProgram(program, 1, &device, nullptr, nullptr, nullptr);
-    if(err != CL_SUCCESS){
-        size_t log_size;
-        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, nullptr, &log_size);
-        std::vector<char> log(log_size);
-        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, log_size, log.data(), nullptr);
-        std::cerr << "Error during operation 'clBuildProgram': " << err << std::endl;
-        std::cerr << "Build log:" << std::endl << log.data() << std::endl;
-        exit(1);
+        this->program = buildProgram(generate_opencl_source(rule, x, y, cells));
+        this->evolve_kernel = clCreateKernel(program, "evolve", &err);
+        checkError(err, "clCreateKernel evolve");
+
+        // The compiled kernel can allow less than the device (registers, local memory)
+        size_t kernel_max = 0;
+        err = clGetKernelWorkGroupInfo(evolve_kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernel_max), &kernel_max, nullptr);
+        checkError(err, "clGetKernelWorkGroupInfo");
+        if ((size_t)x * y <= kernel_max) {
+            break;
+        }
+        clReleaseKernel(evolve_kernel);
+        clReleaseProgram(program);
+        max_group = std::max<size_t>(1, kernel_max);
+    }
+    cl_shape[0] = x;
+    cl_shape[1] = y;
+    cl_shape[2] = cells;
+    if (debug) {
+        std::cout << "OpenCL evolve kernel with " << get_cl_group() << " work-groups" << std::endl;
     }
+}
 
-    this->evolve_kernel = clCreateKernel(program, "evolve", &err);
-    checkError(err, "clCreateKernel evolve");
+std::string GameOfLife::get_cl_group() {
+    const int* shape = cl_shape[0] ? cl_shape : cl_group;
+    return std::to_string(shape[0]) + "x" + std::to_string(shape[1]) + "x" + std::to_string(shape[2]);
+}
 
-    //======================================================================================
-    
-    // Get the path to the compare_kernel
-    path = readKernelSource("comparison.cl");
-    const char *src = path.c_str();
+cl_program GameOfLife::buildProgram(const std::string& source) {
+    cl_int err;
+    const char *src = source.c_str();
 
-    this->program = clCreateProgramWithSource(context, 1, &src, nullptr, &err);
+    cl_program built = clCreateProgramWithSource(context, 1, &src, nullptr, &err);
     checkError(err, "clCreateProgramWithSource");
 
     // Creates the program
-    err = clBuildProgram(program, 1, &device, nullptr, nullptr, nullptr);
+    err = clBuildProgram(built, 1, &device, nullptr, nullptr, nullptr);
     if(err != CL_SUCCESS){
         size_t log_size;
-        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, nullptr, &log_size);
+        clGetProgramBuildInfo(built, device, CL_PROGRAM_BUILD_LOG, 0, nullptr, &log_size);
         std::vector<char> log(log_size);
-        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, log_size, log.data(), nullptr);
+        clGetProgramBuildInfo(built, device, CL_PROGRAM_BUILD_LOG, log_size, log.data(), nullptr);
         std::cerr << "Error during operation 'clBuildProgram': " << err << std::endl;
         std::cerr << "Build log:" << std::endl << log.data() << std::endl;
         exit(1);
     }
-
-    this->compare_kernel = clCreateKernel(program, "compare", &err);
-    checkError(err, "clCreateKernel comparison");
+    return built;
 }
 
 bool GameOfLife::is_stable() {
-    return (std::equal(present.begin(), present.end(), future.begin())
-    || std::equal(past.begin(), past.end(), future.begin()));
+    // Compares against every generation that is kept, the default depth checks n and n-1 only.
+    // No hashes here (only "tiled" has them): std::equal stops at the first difference, a hash reads everything.
+    if (std::equal(present.begin(), present.end(), future.begin())
+    || std::equal(past.begin(), past.end(), future.begin())) {
+        return true;
+    }
+    for (size_t k = 2; k < history_filled + 2; ++k) {
+        const std::vector<uint8_t>& old = generation_back(k);
+        if (std::equal(old.begin(), old.end(), future.begin())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void GameOfLife::rotate_history() {
+    /*
+    + Only the buffers are swapped (O(1)), no generation is copied. The oldest buffer becomes the new
+    + future and is overwritten by the next evolve.
+    */
+    std::swap(past, present);   // past = n, present = n-1
+    std::swap(present, future); // present = n+1, future = n-1
+    if (!history.empty()) {
+        std::swap(future, history[history_head]); // n-1 goes into the ring, the oldest one comes out
+        history_head = (history_head + 1) % history.size();
+        history_filled = std::min(history_filled + 1, history.size());
+    }
+}
+
+void GameOfLife::reset_history() {
+    for (std::vector<uint8_t>& old : history) {
+        old.assign(w_size, 0);
+    }
+    history_head = 0;
+    history_filled = 0;
+}
+
+const std::vector<uint8_t>& GameOfLife::generation_back(size_t k) const {
+    if (k == 0) {
+        return present;
+    }
+    if (k == 1) {
+        return past;
+    }
+    // The newest entry of the ring (n-2) is right before history_head
+    return history[(history_head + history.size() - (k - 1)) % history.size()];
+}
+
+void GameOfLife::set_history_depth(size_t depth) {
+    history.resize(depth > 3 ? depth - 3 : 0);
+    reset_history();
 }
 
 void GameOfLife::print() {
     int l = 0;
 
     if (!debug) {
-    std::cout << CLEAN;
-    std::for_each(present.begin(), present.end(), [this, &l](int live){
-            std::cout << (live ? LIVE : DEAD) << " ";
+    // The whole map in one buffer and one write, see Renderer for drawing while the simulation runs
+    std::string frame = CLEAN;
+    frame.reserve(CLEAN.size() + w_size * (LIVE.size() + 1) + height);
+    std::for_each(present.begin(), present.end(), [this, &l, &frame](int live){
+            frame += live ? LIVE : DEAD;
+            frame += ' ';
             l++;
-            if (l%width == 0){std::cout << "\n";
+            if (l%width == 0){frame += '\n';
             }
         });
+    std::cout.write(frame.data(), frame.size());
     } else {
         std::cout << "This is the present map" << std::endl;
         std::for_each(present.begin(), present.end(), [this, &l](int live) {
@@ -331,6 +1021,39 @@ void GameOfLife::print() {
 }
 
 void GameOfLife::load(std::string p) {
+    // Binary worlds and checkpoints are recognized by their magic, everything else is read as text
+    world_generation = 0;
+    if (is_checkpoint(p)) {
+        Checkpoint checkpoint;
+        read_checkpoint(p, checkpoint);
+        height = checkpoint.height;
+        width = checkpoint.width;
+        present.swap(checkpoint.map);
+        w_size = height * width;
+        // Older checkpoints have no past, their run may stop one generation later than the uninterrupted one
+        past = checkpoint.past.size() == w_size ? std::move(checkpoint.past) : std::vector<uint8_t>(w_size);
+        future = std::vector<uint8_t>(w_size);
+        reset_history();
+        recount_population();
+        rule = parse_rule(checkpoint.rule);
+        data.clear();
+        for (double seconds : checkpoint.data) {
+            data.push_back(std::chrono::duration<double>(seconds));
+        }
+        data_generations = checkpoint.data_generations;
+        world_generation = checkpoint.generation;
+        return;
+    }
+    if (is_binary_world(p)) {
+        read_binary_world(p, height, width, present);
+        w_size = height * width;
+        past = std::vector<uint8_t>(w_size);
+        future = std::vector<uint8_t>(w_size);
+        reset_history();
+        recount_population();
+        return;
+    }
+
     std::ifstream file(p);
     if (file.is_open()) {
         if (!(file >> height >> width)) {
@@ -343,14 +1066,17 @@ void GameOfLife::load(std::string p) {
         past = std::vector<uint8_t>(w_size);
         present = std::vector<uint8_t>(w_size);
         future = std::vector<uint8_t>(w_size);
+        reset_history();
 
+        // 0 and 1, Generations worlds also have the dying states 2 to 9, the rule is checked when the run starts
         for (uint8_t & pre : present) {
             char c;
-            if (!(file >> c) || (c != '0' && c != '1')) {
-                throw std::runtime_error("Invalid data in file. Expected '0' or '1'.");
+            if (!(file >> c) || c < '0' || c > '9') {
+                throw std::runtime_error("Invalid data in file. Expected a state from '0' to '9'.");
             }
-            pre = c - '0';  // Convert ASCII '0' or '1' to numeric 0 or 1
+            pre = c - '0';  // Convert the ASCII digit to the numeric state
         }
+        recount_population();
     } else {
         throw std::runtime_error("Failed to open file: " + p);
     }
@@ -360,35 +1086,167 @@ void GameOfLife::save(std::string name) {
     std::ofstream file("../resources/"+name+".txt");
     
     if (file.is_open()) {
-        file << height << " " << width << "\n";
-        for (const uint8_t& num : present) {
-            file << static_cast<int>(num) << "\n";
-        }
+        write_text(file);
     } else {
         throw std::runtime_error("Failed to open file for writing.");
     }
 }
 
-void GameOfLife::save_game(std::string name){
-    save(name);
+void GameOfLife::write_text(std::ostream& file) const {
+    if (std::any_of(present.begin(), present.end(), [](uint8_t s) { return s > 9; })) {
+        throw std::runtime_error("The text format only holds the states 0 to 9, save the world as .bin or .rle");
+    }
+    file << height << " " << width << "\n";
+    for (const uint8_t& num : present) {
+        file << static_cast<int>(num) << "\n";
+    }
+}
+
+void GameOfLife::check_states() const {
+    uint8_t highest = present.empty() ? 0 : *std::max_element(present.begin(), present.end());
+    if (highest >= rule.states) {
+        throw std::runtime_error("The world has cells in state " + std::to_string(highest) + ", the rule "
+                                 + rule.name + " only has " + std::to_string(rule.states) + " states");
+    }
+}
+
+void GameOfLife::save_game(std::string name, std::string format){
+    if (format == "bin") {
+        // The dying states of Generations rules need a byte per cell
+        WorldEncoding encoding = is_two_state(present) ? WorldEncoding::BITS : WorldEncoding::BYTES;
+        write_binary_world("../resources/"+name+".bin", height, width, present, encoding);
+    } else if (format == "bin8") {
+        write_binary_world("../resources/"+name+".bin", height, width, present, WorldEncoding::BYTES);
+    } else {
+        save(name);
+    }
+}
+
+void GameOfLife::set_checkpoints(const std::string& path, int every_gens, double every_seconds, bool compress) {
+    checkpoint_path = path;
+    checkpoint_every = std::max(0, every_gens);
+    checkpoint_seconds = std::max(0.0, every_seconds);
+    checkpoint_compress = compress;
+}
+
+void GameOfLife::start_checkpoints() {
+    if (checkpoint_path.empty()) {
+        return;
+    }
+    checkpoints.start(checkpoint_path, checkpoint_compress);
+    checkpoint_generation = world_generation;
+    checkpoint_time = Clock_t::now();
+}
+
+bool GameOfLife::checkpoint_due() {
+    return (checkpoint_every > 0 && world_generation - checkpoint_generation >= (uint64_t)checkpoint_every)
+        || (checkpoint_seconds > 0 && std::chrono::duration<double>(Clock_t::now() - checkpoint_time).count() >= checkpoint_seconds);
+}
+
+bool GameOfLife::take_checkpoint(bool wait) {
+    if (!checkpoints.submit(height, width, world_generation, rule.name, past, present, data, data_generations, wait)) {
+        return false;
+    }
+    checkpoint_generation = world_generation;
+    checkpoint_time = Clock_t::now();
+    return true;
+}
+
+void GameOfLife::finish_checkpoints() {
+    if (checkpoint_path.empty()) {
+        return;
+    }
+    PROFILE_SCOPE("checkpoint");
+    take_checkpoint(true);
+    checkpoints.stop();
+    if (debug) {
+        std::cout << checkpoints.get_written() << " checkpoints written into " << checkpoint_path << std::endl;
+    }
 }
 
 void GameOfLife::load_world(std::string path) {
     load(path);
 }
 
+void GameOfLife::save_world(std::string path) {
+    // Unlike save_game() the path is used as it is, the format comes from the extension
+    auto has_extension = [&path](const std::string& ext) {
+        return path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+    };
+
+    if (has_extension(".bin")) {
+        WorldEncoding encoding = is_two_state(present) ? WorldEncoding::BITS : WorldEncoding::BYTES;
+        write_binary_world(path, height, width, present, encoding);
+        return;
+    }
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file for writing: " + path);
+    }
+    if (has_extension(".rle")) {
+        write_rle(file, present, height, width, rule.name, rule.states);
+    } else if (has_extension(".cells")) {
+        write_cells(file, present, height, width);
+    } else {
+        write_text(file);
+    }
+    if (!file) {
+        throw std::runtime_error("Failed to write file: " + path);
+    }
+}
+
+void GameOfLife::load_pattern(std::string path, size_t x, size_t y) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+
+    // The live (and dying) cells are written straight into the world, dead cells of the pattern leave the world as it is
+    LiveRunCallback live = [this, x, y](int64_t dx, int64_t dy, int64_t length, uint8_t state) {
+        for (int64_t k = 0; k < length; ++k) {
+            set_state(x + dx + k, y + dy, state);
+        }
+    };
+
+    bool cells = path.size() >= 6 && path.compare(path.size() - 6, 6, ".cells") == 0;
+    PatternInfo info = cells ? read_cells(file, live) : read_rle(file, live);
+    if (!info.rule.empty() && debug) {
+        try {
+            if (parse_rule(info.rule).name != rule.name) {
+                std::cout << "The pattern was made for the rule " << info.rule << std::endl;
+            }
+        } catch (const std::invalid_argument&) {
+            std::cout << "The pattern was made for the unknown rule " << info.rule << std::endl;
+        }
+    }
+}
+
+void GameOfLife::save_pattern(std::string name, std::string format) {
+    std::ofstream file("../resources/" + name + "." + format);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file for writing.");
+    }
+    if (format == "cells") {
+        write_cells(file, present, height, width);
+    } else {
+        write_rle(file, present, height, width, rule.name, rule.states);
+    }
+}
+
 void GameOfLife::set_state(size_t i, uint8_t s) {
-    if (i > present.size()) {
+    if (i >= present.size()) {
         std::cout << "Invalid index";
         return;
     }
+    population += (s == 1);
+    population -= (present[i] == 1);
     present[i] = s;
 }
 
 void GameOfLife::set_state(size_t x, size_t y, uint8_t s) {
     x = (x+width) % width;
     y = (y+height) % height;
-    present[y * width + x] = s;
+    set_state(y * width + x, s);
 }
 
 void GameOfLife::set_states(std::vector<std::tuple<size_t, size_t, uint8_t>>& states) {
@@ -459,177 +1317,36 @@ void GameOfLife::checkError(cl_int err, const char* operation) {
     }
 }
 
-double GameOfLife::get_entropy(const std::vector<uint8_t>& world_map) {
-    std::unordered_map<int, int> frequencies;
-    int totalCells = w_size;
-    int numThreads = omp_get_max_threads();
-    
-    // Create a vector of maps to store local frequency counts for each thread
-    std::vector<std::unordered_map<int, int>> partialSum(numThreads);
-
-    #pragma omp parallel
-    {
-        int threadId = omp_get_thread_num();
-        std::unordered_map<int, int>& localFrequencyMap = partialSum[threadId];
-        
-        #pragma omp for
-        for (int i = 0; i < totalCells; ++i) {
-            localFrequencyMap[world_map[i]]++;
-        }
-    }
-
-    // Combine them back into the global map
-    for (const auto& localFrequencyMap : partialSum) {
-        for (const auto& pair : localFrequencyMap) {
-            frequencies[pair.first] += pair.second;
-        }
-    }
-
-    // Calculate the Shannon entropy
-    double entropy = 0.0;
-    for (const auto& pair : frequencies) {
-        double probability = static_cast<double>(pair.second) / totalCells;
-        if (probability > 0) {
-            entropy -= probability * std::log2(probability);
-        }
-    }
-    if (debug){
-        std::cout << entropy << " This is entropy" << std::endl;
-    }
-    return entropy;
-}
-
-void GameOfLife::simple_randomize(){
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    
-    std::uniform_int_distribution<> dis(0,1);
-    std::for_each(present.begin(), present.end(), [&](uint8_t &cell){
-        cell = static_cast<uint8_t>(dis(gen));
-    });
+void GameOfLife::simple_randomize(double density){
+    // Counter based, every thread fills its part of the world and the seed fixes the result
+    population = seed_random(present.data(), w_size, seed, density);
 }
 
 void GameOfLife::randomize(double targetEntropy, int maxIterations) {
-    // Randomnes
-    std::random_device rd;
-    std::mt19937 gen(rd());
-
-    // Needed calculation (I did this to avoid overpopulation)
-    double entropy = get_entropy(present);
-    int iteration = 0;
-
-    // Adjust population to achieve target entropy
-    while ((entropy - targetEntropy) < 0.01 && iteration < maxIterations) {
-        //Random numbers
-        std::uniform_int_distribution<> dis(0,4);
-        std::uniform_int_distribution<> indx(0, width - 1);
-        std::uniform_int_distribution<> indy(0, height - 1);
-
-         
-        int k = dis(gen);
-        int x = indx(gen);
-        int y = indy(gen);
-        
-        switch(k)
-        {
-            case 0:
-            //Random figure that i found in internet
-                set_state(x,y,1);
-                set_state(x+1,y,1);
-                set_state(x+2,y,1);
-                set_state(x-1,y-1,1);
-                break;
-            case 1:
-                addBeacon(x,y);
-                break;
-            case 2:
-                addToad(x,y);
-                break;
-            case 3:
-                addGlider(x,y);
-                break;
-            case 4:
-                addMethuselah(x,y);
-                break;
-        }
-        
-        entropy = get_entropy(present);
-        iteration++;
+    // Adds figures until H(map) is 0.01 above the target (I did this to avoid overpopulation)
+    size_t figures = seed_figures(present.data(), height, width, seed, targetEntropy, maxIterations, population);
+    if (debug){
+        std::cout << figures << " figures added, entropy " << get_entropy() << std::endl;
     }
 }
 
 void GameOfLife::randomize1(double targetEntropy, int maxIterations) {
-    // Randomness
-    std::random_device rd;
-    std::mt19937 gen(rd());
-
-    // Calculate initial entropy
-    double entropy = get_entropy(present);
-    std::atomic<bool> flag(false);
-
-    // Adjust population to achieve target entropy
-    #pragma omp parallel
-    {   
-        // Random numbers
-        std::uniform_int_distribution<> dis(0, 4);
-        std::uniform_int_distribution<> indx(0, width - 1);
-        std::uniform_int_distribution<> indy(0, height - 1);
-
-        #pragma omp for 
-        for (int iteration = 0; iteration < maxIterations; ++iteration) {
-            
-            int k = dis(gen);
-            int x = indx(gen);
-            int y = indy(gen);
-            
-            if (flag.load()) continue;
-
-            // Update entropy (Race condition MUST be avoided)
-            // Adds the figure following a random normal distribution
-            #pragma omp critical
-            {
-                switch(k) {
-                    case 0:
-                        // Random figure that I found on the internet
-                        set_state(x, y, 1);
-                        set_state(x + 1, y, 1);
-                        set_state(x + 2, y, 1);
-                        set_state(x - 1, y - 1, 1);
-                        break;
-                    case 1:
-                        addBeacon(x, y);
-                        break;
-                    case 2:
-                        addToad(x, y);
-                        break;
-                    case 3:
-                        addGlider(x, y);
-                        break;
-                    case 4:
-                        addMethuselah(x, y);
-                        break;
-                }
-                entropy = get_entropy(present);
-            }
+    randomize(targetEntropy, maxIterations);
+}
 
-            if(debug){
-                std::cout << "We are in iteration " << iteration << " of the population" << std::endl;
-                std::this_thread::sleep_for(std::chrono::milliseconds(250));
-            }
+std::vector<std::chrono::duration<double>> GameOfLife::get_data(){
+    return this->data;
+}
 
-            // Check if desired entropy level was achieved
-            if ((entropy - targetEntropy) >= 0.01) {
-                /*
-                Stops the loop execution thanks to https://stackoverflow.com/questions/9793791/parallel-openmp-loop-with-break-statement
-                that helped me to get how to get out as break is not allowed inside OpenMP loops.
-                */
-                flag.store(true);
-                #pragma omp cancel for
-            }
-        }
+std::vector<double> GameOfLife::get_seconds_per_generation() {
+    std::vector<double> seconds(data.size());
+    for (size_t k = 0; k < data.size(); ++k) {
+        seconds[k] = data[k].count() / std::max<uint32_t>(1, data_generations[k]);
     }
+    return seconds;
 }
 
-std::vector<std::chrono::duration<double>> GameOfLife::get_data(){
-    return this->data;
+void GameOfLife::recount_population() {
+    // Only for worlds that were written as a whole (loaded or computed outside of the host generations)
+    population = std::count(present.begin(), present.end(), 1);
 }
@@ -13,12 +13,45 @@
 #include <algorithm>
 #include <chrono>
 #include <thread>
+#include <memory>
 #include <gegl-0.4/opencl/cl.h>
 #include <omp.h>
+#include "Stencil.h"
+#include "BitBoard.h"
+#include "SimdEvolve.h"
+#include "Hashlife.h"
+#include "TiledEngine.h"
+#include "WorldFile.h"
+#include "PatternIO.h"
+#include "Profiler.h"
+#include "DistributedEngine.h"
+#include "TemporalBlocking.h"
+#include "Seeding.h"
+#include "SparseLife.h"
+#include "Renderer.h"
+#include "Checkpoint.h"
+#include "Rule.h"
 
 using Clock_t = std::chrono::steady_clock;
 using TimeUnit_t = std::chrono::milliseconds;
 
+// One entry per entry of get_data(), taken after the generation(s) of that entry were computed
+struct GenerationStats {
+    uint64_t generation; // Generations run so far in this run
+    size_t population;   // Live cells of the computed generation
+    size_t births;       // Cells that became alive since the previous entry
+    size_t deaths;
+};
+
+// A batch of generations "CL-persistent" queued on the device, with the flags of every generation
+struct ResidentBatch {
+    cl_mem present = nullptr, past = nullptr; // The last two generations of the batch
+    cl_mem flags = nullptr;                   // One int per generation, bit 0 changed from map, bit 1 from older
+    std::vector<cl_int> changed;              // Host copy of flags, read without blocking
+    cl_event ready = nullptr;                 // Of the read of flags
+    size_t events = 0;                        // Profiled events up to the read of flags, see collect_cl_events()
+    int gens = 0;
+};
 
 class GameOfLife {
     private:
@@ -28,20 +61,79 @@ class GameOfLife {
         const std::string CLEAN = "\033[2J\033[H";
 
         std::vector<std::chrono::duration<double>> data;
+        std::vector<uint32_t> data_generations; // Generations every entry of data covers (hashlife jumps, temporal passes, CL batches)
         int width, height;
         size_t w_size;
         std::vector<uint8_t> past, present, future; // This definition is completely optional
+        // Generations older than past (n-2, n-3, ...), history[history_head] is the oldest one
+        std::vector<std::vector<uint8_t>> history;
+        size_t history_head = 0, history_filled = 0;
+        BitBoard bit_past, bit_present, bit_future; // Only used by the "bitpacked" simulation
+        std::unique_ptr<uint8_t[]> band_past, band_present, band_future; // Only used by the "omp" simulation
+        omp_sched_t omp_schedule = omp_sched_static;
+        int omp_chunk = 0; // 0 lets OpenMP choose (one contiguous band per thread for static)
+        std::string simd_isa = "auto"; // Instruction set for the "simd" simulation
+        Hashlife hashlife; // Only used by the "hashlife" simulation
+        SparseLife sparse; // Only used by the "sparse" simulation
+        TiledEngine tiled; // Only used by the "tiled" simulation
+        int tile_size = 64;
+        int period_window = 60; // Longest period "tiled" detects as stable
+        std::vector<double> tile_activity; // Fraction of the tiles recomputed in each generation
+        int ranks = 4; // Processes of the "distributed" simulation
+        Rule rule = parse_rule("B3/S23");
+        RuleSpanKernel rule_kernel = nullptr; // Selected for the rule at the start of every run
+        int temporal_k = 8; // Generations per pass of the "temporal" simulation
+        int temporal_tile = 256; // Tile plus halos of both buffers stays in L2
+        uint64_t seed = std::random_device{}(); // Seed of simple_randomize() and randomize()
         bool print_enable = false;
+        Renderer renderer; // Draws the world on its own thread while print_enable is on
         bool debug = false;
-        int print_delay_ms = 200;
+        bool headless = false; // Batch runs: no pauses and no terminal escapes
+        std::string engine_used; // Type of the last run after a possible fallback
+        bool stopped_stable = false;
+        bool plane_edge = false; // "hashlife" and "sparse" had live cells on the edge of the window in the last run
+        void check_plane_edge(bool outside);
+        uint64_t generations_run = 0;
+        int print_delay_ms = 200; // Shortest time between two frames, the simulation does not wait for them
+        // Live cells of present, kept up to date by set_state(), the seeding and every evolve
+        size_t population = 0;
+        size_t step_births = 0, step_deaths = 0; // Of the last evolve, filled by the engines
+        bool track_statistics = true;
+        std::vector<GenerationStats> generation_stats;
+        void recount_population();
+        uint64_t world_generation = 0; // Generation of present since the world was created, restored from checkpoints
+        CheckpointWriter checkpoints; // Writes the checkpoints of a run on its own thread
+        std::string checkpoint_path; // Empty when no checkpoints are taken
+        int checkpoint_every = 0; // Generations between two checkpoints, 0 only uses the time
+        double checkpoint_seconds = 0;
+        bool checkpoint_compress = false;
+        uint64_t checkpoint_generation = 0; // Of the last checkpoint
+        Clock_t::time_point checkpoint_time;
+        bool checkpoint_due();
+        bool take_checkpoint(bool wait); // present must be up to date, false when the writer is still busy
+        void start_checkpoints();
+        void finish_checkpoints(); // The last checkpoint of the run, waits until everything is written
 
         void evolve(std::vector<uint8_t>& map, std::vector<uint8_t>&next, std::vector<uint8_t>& neighbors);
+        void evolve_fused(const std::vector<uint8_t>& map, std::vector<uint8_t>& next);
+        void evolve_row(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out) const;
+        void setup_bands();
+        void evolve_omp();
+        bool is_stable_omp();
+        void evolve_simd(SimdRowKernel kernel);
+        void run_hashlife(int gens);
+        void run_distributed(int gens);
         void evolve_opencl();
-        bool compare_cl();
+        bool compare_cl(); // Reads the flags the evolve_kernel of evolve_opencl() computed
         bool is_stable();
+        void rotate_history();
+        void reset_history();
+        const std::vector<uint8_t>& generation_back(size_t k) const; // 0 is present, 1 is past, ...
         void print();
         void load(std::string p);
         void save(std::string name);
+        void write_text(std::ostream& file) const; // The text format holds one digit per cell, states 0 to 9
+        void check_states() const; // Throws when the world has cells the rule has no state for
         std::vector<uint8_t> count_neighbors(const std::vector<uint8_t>& vec);
         uint8_t get_element_value(const std::vector<uint8_t> &col, size_t x, size_t y) const;
 
@@ -50,25 +142,72 @@ class GameOfLife {
         cl_command_queue queue;
         cl_program program;
         cl_kernel evolve_kernel;
-        cl_kernel compare_kernel;
+        cl_device_id device;
+        int cl_group[3] = {32, 8, 4}; // Requested shape of the evolve kernel: work-items in x and y, cells per work-item
+        int cl_shape[3] = {0, 0, 0}; // Shape the device accepted in the last setupOpenCL()
+        void build_evolve_kernel(); // For the rule, shrinks the shape until the device accepts it
+        // With check >= 0 the kernel ORs into flags[check] whether next differs from map (1) and from older (2)
+        void enqueue_evolve(cl_mem map, cl_mem older, cl_mem next, cl_mem flags, int check);
+        cl_int cl_changed = 0; // Flags of the last generation that was checked
         void setupOpenCL();
+        cl_program buildProgram(const std::string& source);
         std::string readKernelSource(const char *filename);
 
-        // Extra stuff
-        double get_entropy(const std::vector<uint8_t>& map);
+        // Device resident generations for "CL-persistent": a generation is written into any of the buffers that is
+        // not its map or older and not the end of the batch before, so at most four of the five are in use
+        cl_mem cl_history[5] = {nullptr, nullptr, nullptr, nullptr, nullptr};
+        cl_mem cl_present = nullptr, cl_past = nullptr; // End of the last batch the host checked
+        ResidentBatch cl_batches[2]; // Batch b is in cl_batches[b % 2], b + 1 is queued before the flags of b are read
+        uint64_t cl_queued = 0, cl_checked = 0; // Batches of the run
+        const cl_int cl_zero = 0; // Pattern of the fill that clears the flags
+        int cl_batch = 16; // Generations "CL-persistent" queues before it waits for the flags
+        void setup_resident_cl();
+        void queue_resident_cl(int gens);
+        int compare_resident_cl(); // Index of the first stable generation of the batch, -1 if there is none
+        void read_resident_cl();
+        void release_resident_cl();
+
+        // Events of the queued commands while profiling, read back by collect_cl_events()
+        std::vector<std::pair<cl_event, const char*>> cl_events;
+        cl_event* profile_event(const char* name); // nullptr when the profiler is disabled
+        void collect_cl_events(size_t count = SIZE_MAX); // The first count events, all of them must have finished
 
     public:
         GameOfLife(int h, int w);
         GameOfLife(const std::string& path);
-        void simple_randomize(); // for bigger maps.
+        void simple_randomize(double density = 0.5); // for bigger maps, every cell alive with probability density.
         void randomize(double targetEntropy=0.7, int maxIterations = 10000); // Default value is entropy of 0.7 and 10000 iterations
-        void randomize1(double targetEntropy=0.7, int maxIterations = 10000);// Same as randomize() but parallelized
-        void run_simulation(int gens, std::string type); // type must be "scalar" or "CL", this is case sensitive
+        void randomize1(double targetEntropy=0.7, int maxIterations = 10000);// Same as randomize(), which is parallel now
+        void set_seed(uint64_t s) {seed = s;} // The same seed gives the same world for any number of threads
+        uint64_t get_seed() {return seed;} // Random per object unless set
+        void run_simulation(int gens, std::string type); // type must be "scalar", "CL", "CL-persistent", "bitpacked", "fused", "omp", "simd", "tiled", "temporal", "hashlife", "sparse" or "distributed", this is case sensitive
         void toggle_display() {print_enable = !print_enable;} // Default is always OFF
         void toggle_debug(){debug = !debug;}// Default is OFF
+        void set_headless(bool on) {headless = on;} // Default is OFF
         void set_delay(size_t delay_ms) {print_delay_ms = delay_ms;} // Default delay is 200ms
-        void save_game(std::string name);
-        void load_world(std::string path);
+        void set_checkpoints(const std::string& path, int every_gens, double every_seconds = 0, bool compress = false); // An empty path turns them off
+        uint64_t get_generation() {return world_generation;} // Continues where a loaded checkpoint stopped
+        void set_viewport(int x, int y, int cols, int rows, int block = 1) {renderer.set_viewport({x, y, cols, rows, block});} // block > 1 draws the density of block x block squares
+        size_t get_frames_dropped() {return renderer.get_dropped();} // Generations the display of the last run skipped
+        void set_history_depth(size_t depth); // Generations kept including future (minimum and default 3)
+        void set_schedule(const std::string& kind, int chunk = 0); // "static" or "dynamic" row bands for "omp"
+        void set_simd(const std::string& isa) {simd_isa = isa;} // "auto", "avx512", "avx2", "sse" or "scalar"
+        void set_hashlife_memory(size_t mb) {hashlife.set_memory_limit(mb << 20);} // Default is 1024MB
+        size_t get_hashlife_peak_memory() {return hashlife.get_peak_memory_usage();} // Bytes of the node cache in the last run
+        void set_tile_size(int size) {tile_size = size;} // Side of the square tiles of "tiled", default is 64
+        void set_period_window(int gens) {period_window = gens;} // 2 stops "tiled" like "scalar" does
+        void set_ranks(int n) {ranks = n;} // Processes (blocks) of "distributed", default is 4
+        void set_rule(const std::string& rulestring) {rule = parse_rule(rulestring);} // B/S, Generations or LtL, default is B3/S23
+        std::string get_rule() {return rule.name;}
+        void set_cl_group(int x, int y, int cells = 4) {cl_group[0] = x; cl_group[1] = y; cl_group[2] = cells; cl_shape[0] = 0;} // Work-group of "CL" and "CL-persistent", default is 32x8 with 4 cells per work-item
+        std::string get_cl_group(); // "32x8x4", the shape the device accepted in the last CL run, the requested one before
+        void set_cl_batch(int k) {cl_batch = k;} // Generations "CL-persistent" queues without waiting, default is 16
+        void set_temporal(int k, int tile = 256) {temporal_k = k; temporal_tile = tile;} // Generations per pass and tile side of "temporal", default is 8
+        void save_game(std::string name, std::string format = "txt"); // "txt", "bin" (1 bit per cell) or "bin8" (1 byte per cell)
+        void load_world(std::string path); // Text, binary or checkpoint, the format is detected from the file
+        void save_world(std::string path); // Exact path, .bin, .rle and .cells by extension, text otherwise
+        void load_pattern(std::string path, size_t x, size_t y); // .rle or .cells, top-left corner placed at (x, y)
+        void save_pattern(std::string name, std::string format); // "rle" or "cells", only the live bounding box
         void set_state(size_t i, uint8_t s);
         void set_state(size_t x, size_t y, uint8_t s);
         void set_states(std::vector<std::tuple<size_t, size_t, uint8_t>>& states);
@@ -81,6 +220,23 @@ class GameOfLife {
         void display(); // For testing porpuse only streams the map into the console.
         void checkError(cl_int err, const char* operation);
         std::vector<std::chrono::duration<double>> get_data();
+        std::vector<uint32_t> get_data_generations() {return data_generations;} // Alongside get_data()
+        std::vector<double> get_seconds_per_generation(); // Every entry of get_data() divided by its generations
+        int get_height() {return height;}
+        int get_width() {return width;}
+        std::string get_engine() {return engine_used;}
+        bool is_stopped_stable() {return stopped_stable;} // The last run ended because the world was stable
+        std::string get_topology() {return engine_used == "hashlife" || engine_used == "sparse" ? "plane" : "torus";} // Of the last run
+        bool reached_plane_edge() {return plane_edge;} // The unbounded plane of the last run no longer matched the torus
+        uint64_t get_generations_run() {return generations_run;}
+        size_t get_population() {return population;} // O(1), cells in state 1
+        double get_density() {return w_size ? (double)population / w_size : 0.0;}
+        double get_entropy() {return binary_entropy(population, w_size);} // Shannon entropy of live/dead cells
+        std::vector<GenerationStats> get_generation_stats() {return generation_stats;} // Alongside get_data()
+        void set_statistics(bool on) {track_statistics = on;} // Off skips the counting, the population is counted after the run
+        std::vector<double> get_tile_activity() {return tile_activity;}
+        void set_profiling(bool on) {Profiler::get().enable(on);} // Must be set before the run for the CL queue
+        bool save_trace(const std::string& path) {return Profiler::get().write_chrome_trace(path);} // Chrome trace-event JSON
 };
 
 
@@ -0,0 +1,371 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include "../include/Hashlife.h"
+
+Hashlife::Hashlife() {
+    // The two leaves are never stored in the hash table
+    nodes.push_back({NONE, NONE, NONE, NONE, NONE, 0, 0, 0});
+    nodes.push_back({NONE, NONE, NONE, NONE, NONE, 0, 0, 1});
+    table.assign(1 << 16, NONE);
+}
+
+uint64_t Hashlife::hash(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+    uint64_t h = nw * 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 29)) + ne * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 31)) + sw * 0x94D049BB133111EBULL;
+    h = (h ^ (h >> 29)) + se * 0xD6E8FEB86659FD93ULL;
+    return h ^ (h >> 32);
+}
+
+uint32_t Hashlife::join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+    size_t mask = table.size() - 1;
+    size_t slot = hash(nw, ne, sw, se) & mask;
+
+    while (table[slot] != NONE) {
+        const Node& n = nodes[table[slot]];
+        if (n.nw == nw && n.ne == ne && n.sw == sw && n.se == se) {
+            return table[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    // Not found, the node is created (children always have a smaller index than their parents)
+    uint32_t index = nodes.size();
+    uint64_t population = nodes[nw].population + nodes[ne].population + nodes[sw].population + nodes[se].population;
+    nodes.push_back({nw, ne, sw, se, NONE, (uint8_t)(nodes[nw].level + 1), 0, population});
+    table[slot] = index;
+
+    if (++table_used * 2 > table.size()) {
+        grow_table();
+    }
+    return index;
+}
+
+void Hashlife::grow_table() {
+    table.assign(table.size() * 2, NONE);
+    size_t mask = table.size() - 1;
+    for (uint32_t i = 2; i < nodes.size(); ++i) {
+        const Node& n = nodes[i];
+        size_t slot = hash(n.nw, n.ne, n.sw, n.se) & mask;
+        while (table[slot] != NONE) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = i;
+    }
+}
+
+uint32_t Hashlife::empty(int level) {
+    while ((int)empty_nodes.size() <= level) {
+        if (empty_nodes.empty()) {
+            empty_nodes.push_back(0);
+        } else {
+            uint32_t e = empty_nodes.back();
+            empty_nodes.push_back(join(e, e, e, e));
+        }
+    }
+    return empty_nodes[level];
+}
+
+uint32_t Hashlife::centre(uint32_t n) {
+    Node c = nodes[n];
+    return join(nodes[c.nw].se, nodes[c.ne].sw, nodes[c.sw].ne, nodes[c.se].nw);
+}
+
+uint32_t Hashlife::expand(uint32_t n) {
+    // Same center, twice the size, the old node ends up in the middle surrounded by empty space
+    Node c = nodes[n];
+    uint32_t e = empty(c.level - 1);
+    return join(join(e, e, e, c.nw), join(e, e, c.ne, e), join(e, c.sw, e, e), join(c.se, e, e, e));
+}
+
+bool Hashlife::is_centred(uint32_t n) const {
+    // Everything alive is inside the center quarter of n
+    const Node& c = nodes[n];
+    if (c.level < 2) {
+        return false;
+    }
+    const Node &nw = nodes[c.nw], &ne = nodes[c.ne], &sw = nodes[c.sw], &se = nodes[c.se];
+    uint64_t outer = nodes[nw.nw].population + nodes[nw.ne].population + nodes[nw.sw].population
+                   + nodes[ne.nw].population + nodes[ne.ne].population + nodes[ne.se].population
+                   + nodes[sw.nw].population + nodes[sw.sw].population + nodes[sw.se].population
+                   + nodes[se.ne].population + nodes[se.sw].population + nodes[se.se].population;
+    return outer == 0;
+}
+
+uint32_t Hashlife::trimmed(uint32_t n) {
+    // Smallest centered node with the same content, equal worlds always give the same node
+    while (nodes[n].level > 2 && is_centred(n)) {
+        n = centre(n);
+    }
+    return n;
+}
+
+uint32_t Hashlife::base_result(uint32_t n) {
+    // Level 2 node (4x4 cells), the 2x2 center is advanced by one generation by brute force
+    Node c = nodes[n];
+    uint32_t quads[4] = {c.nw, c.ne, c.sw, c.se};
+    int cells[4][4];
+    for (int q = 0; q < 4; ++q) {
+        const Node& s = nodes[quads[q]];
+        int x = (q % 2) * 2, y = (q / 2) * 2;
+        cells[y][x] = s.nw;
+        cells[y][x + 1] = s.ne;
+        cells[y + 1][x] = s.sw;
+        cells[y + 1][x + 1] = s.se;
+    }
+
+    uint32_t next[4];
+    for (int q = 0; q < 4; ++q) {
+        int x = 1 + q % 2, y = 1 + q / 2;
+        int count = 0;
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                if (dx != 0 || dy != 0) {
+                    count += cells[y + dy][x + dx];
+                }
+            }
+        }
+        next[q] = (count == 3 || (cells[y][x] && count == 2)) ? 1 : 0;
+    }
+    return join(next[0], next[1], next[2], next[3]);
+}
+
+uint32_t Hashlife::result(uint32_t n, int step) {
+    /*
+    + Returns the center of n (one level smaller) advanced by 2^step generations, step <= level - 2.
+    + The node is split into 9 overlapping sub-squares, with the full step each of them is advanced by half
+    + the time and the 4 combinations by the other half. With a smaller step the 9 sub-squares are only
+    + centered and the whole step is done by the combinations.
+    */
+    Node c = nodes[n];
+    if (c.result != NONE && c.result_step == step) {
+        return c.result;
+    }
+
+    uint32_t r;
+    if (c.level == 2) {
+        r = base_result(n);
+    } else {
+        Node a = nodes[c.nw], b = nodes[c.ne], d = nodes[c.sw], e = nodes[c.se];
+        uint32_t sub[9] = {
+            c.nw, join(a.ne, b.nw, a.se, b.sw), c.ne,
+            join(a.sw, a.se, d.nw, d.ne), join(a.se, b.sw, d.ne, e.nw), join(b.sw, b.se, e.nw, e.ne),
+            c.sw, join(d.ne, e.nw, d.se, e.sw), c.se
+        };
+
+        bool full = (step == c.level - 2);
+        for (uint32_t& s : sub) {
+            s = full ? result(s, c.level - 3) : centre(s);
+        }
+
+        int inner = full ? c.level - 3 : step;
+        uint32_t q0 = result(join(sub[0], sub[1], sub[3], sub[4]), inner);
+        uint32_t q1 = result(join(sub[1], sub[2], sub[4], sub[5]), inner);
+        uint32_t q2 = result(join(sub[3], sub[4], sub[6], sub[7]), inner);
+        uint32_t q3 = result(join(sub[4], sub[5], sub[7], sub[8]), inner);
+        r = join(q0, q1, q2, q3);
+    }
+
+    nodes[n].result = r;
+    nodes[n].result_step = step;
+    return r;
+}
+
+void Hashlife::collect_garbage() {
+    /*
+    + Keeps the nodes reachable from the root and the empty nodes, every memoized result is dropped.
+    + As children are always older than their parents one pass from the back marks everything.
+    */
+    std::vector<uint8_t> keep(nodes.size(), 0);
+    keep[0] = keep[1] = 1;
+    keep[root] = 1;
+    for (uint32_t e : empty_nodes) {
+        keep[e] = 1;
+    }
+    for (uint32_t p : pinned) {
+        keep[p] = 1;
+    }
+    for (size_t i = nodes.size(); i-- > 2;) {
+        if (keep[i]) {
+            const Node& n = nodes[i];
+            keep[n.nw] = keep[n.ne] = keep[n.sw] = keep[n.se] = 1;
+        }
+    }
+
+    std::vector<uint32_t> remap(nodes.size(), NONE);
+    size_t next = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (!keep[i]) {
+            continue;
+        }
+        Node n = nodes[i];
+        if (i > 1) {
+            n.nw = remap[n.nw];
+            n.ne = remap[n.ne];
+            n.sw = remap[n.sw];
+            n.se = remap[n.se];
+        }
+        n.result = NONE;
+        remap[i] = next;
+        nodes[next++] = n;
+    }
+    nodes.resize(next);
+    nodes.shrink_to_fit();
+
+    root = remap[root];
+    for (uint32_t& e : empty_nodes) {
+        e = remap[e];
+    }
+    for (uint32_t& p : pinned) {
+        p = remap[p];
+    }
+
+    table_used = nodes.size() - 2;
+    size_t size = 1 << 16;
+    while (size < table_used * 2) {
+        size *= 2;
+    }
+    table.assign(size / 2, NONE);
+    grow_table();
+}
+
+void Hashlife::advance_pow2(int k) {
+    if (root == NONE) {
+        throw std::runtime_error("Hashlife: no world has been imported.");
+    }
+    // Collecting is only safe between steps, during result() the node indices are in use
+    if (get_memory_usage() > memory_limit) {
+        collect_garbage();
+    }
+
+    /*
+    + The result only covers the center half of the root. After the extra expand the pattern is inside the
+    + center quarter, which leaves a margin of 2^(level-3) >= 2^k cells for it to grow during the step.
+    */
+    while (nodes[root].level < k + 2 || !is_centred(root)) {
+        root = expand(root);
+    }
+
+    uint32_t before = trimmed(root);
+    if (k > max_jump) {
+        /*
+        + The limit is only checked between jumps and a single jump can fill the cache far beyond it, so a
+        + jump goes in two halves with a collection in between as long as it is larger than max_jump. It grows by
+        + one after every jump that stayed under the limit and drops below a jump that did not, which keeps the
+        + cache within about twice the limit (a jump takes about twice the nodes of the half) and costs a few
+        + extra jumps at the start. The world before the jump survives the collections for the check below.
+        */
+        pinned.push_back(before);
+        advance_pow2(k - 1);
+        advance_pow2(k - 1);
+        before = pinned.back();
+        pinned.pop_back();
+    } else {
+        root = expand(root);
+        root = result(root, k);
+        generation += (uint64_t)1 << k;
+        size_t memory = get_memory_usage();
+        peak_memory = std::max(peak_memory, memory);
+        max_jump = memory > memory_limit ? std::max(k - 1, 0) : std::max(max_jump, k + 1);
+    }
+    unchanged = (trimmed(root) == before);
+}
+
+void Hashlife::advance(uint64_t gens) {
+    for (int k = 63; k >= 0; --k) {
+        if (gens & ((uint64_t)1 << k)) {
+            advance_pow2(k);
+        }
+    }
+}
+
+uint64_t Hashlife::get_population() const {
+    return root == NONE ? 0 : nodes[root].population;
+}
+
+uint64_t Hashlife::get_population(int64_t x0, int64_t y0, int64_t x1, int64_t y1) const {
+    if (root == NONE) {
+        return 0;
+    }
+    int64_t half = (int64_t)1 << (nodes[root].level - 1);
+    return count(root, -half, -half, x0, y0, x1, y1);
+}
+
+uint64_t Hashlife::count(uint32_t n, int64_t x, int64_t y, int64_t x0, int64_t y0, int64_t x1, int64_t y1) const {
+    // Only the nodes on the border of the rectangle are split, the others are counted by their population
+    const Node& c = nodes[n];
+    int64_t size = (int64_t)1 << c.level;
+    if (c.population == 0 || x >= x1 || y >= y1 || x + size <= x0 || y + size <= y0) {
+        return 0;
+    }
+    if (x >= x0 && y >= y0 && x + size <= x1 && y + size <= y1) {
+        return c.population;
+    }
+    int64_t half = size / 2;
+    return count(c.nw, x, y, x0, y0, x1, y1) + count(c.ne, x + half, y, x0, y0, x1, y1)
+         + count(c.sw, x, y + half, x0, y0, x1, y1) + count(c.se, x + half, y + half, x0, y0, x1, y1);
+}
+
+size_t Hashlife::get_memory_usage() const {
+    return nodes.capacity() * sizeof(Node) + table.capacity() * sizeof(uint32_t);
+}
+
+uint32_t Hashlife::build(int level, int64_t x, int64_t y, const std::vector<uint8_t>& map, int height, int width) {
+    int64_t size = (int64_t)1 << level;
+    if (x >= width || y >= height || x + size <= 0 || y + size <= 0) {
+        return empty(level);
+    }
+    if (level == 0) {
+        return map[y * width + x] ? 1 : 0;
+    }
+    int64_t half = size / 2;
+    uint32_t nw = build(level - 1, x, y, map, height, width);
+    uint32_t ne = build(level - 1, x + half, y, map, height, width);
+    uint32_t sw = build(level - 1, x, y + half, map, height, width);
+    uint32_t se = build(level - 1, x + half, y + half, map, height, width);
+    return join(nw, ne, sw, se);
+}
+
+void Hashlife::import_world(const std::vector<uint8_t>& map, int height, int width) {
+    // The root covers [-2^(level-1), 2^(level-1)) in both directions
+    int level = 3;
+    while (((int64_t)1 << (level - 1)) < std::max(height, width)) {
+        level++;
+    }
+    int64_t half = (int64_t)1 << (level - 1);
+    root = build(level, -half, -half, map, height, width);
+    generation = 0;
+    peak_memory = get_memory_usage();
+    max_jump = 0;
+    unchanged = false;
+}
+
+void Hashlife::write(uint32_t n, int64_t x, int64_t y, std::vector<uint8_t>& map, int height, int width) const {
+    const Node& c = nodes[n];
+    int64_t size = (int64_t)1 << c.level;
+    if (c.population == 0 || x >= width || y >= height || x + size <= 0 || y + size <= 0) {
+        return;
+    }
+    if (c.level == 0) {
+        map[y * width + x] = 1;
+        return;
+    }
+    int64_t half = size / 2;
+    write(c.nw, x, y, map, height, width);
+    write(c.ne, x + half, y, map, height, width);
+    write(c.sw, x, y + half, map, height, width);
+    write(c.se, x + half, y + half, map, height, width);
+}
+
+void Hashlife::export_world(std::vector<uint8_t>& map, int height, int width) const {
+    std::fill(map.begin(), map.end(), 0);
+    if (root == NONE) {
+        return;
+    }
+    int64_t half = (int64_t)1 << (nodes[root].level - 1);
+    write(root, -half, -half, map, height, width);
+}
@@ -0,0 +1,69 @@
+#ifndef HASHLIFE_H
+#define HASHLIFE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
++ Memoized quadtree (Hashlife) for B3/S23. Every node is canonical: the hash table makes sure that two equal
++ squares are always the same node, so the result of a node only has to be computed once.
++ Be noted that Hashlife works on the unbounded plane and not on the torus, patterns that leave the
++ imported window are lost on export.
+*/
+class Hashlife {
+    private:
+        static constexpr uint32_t NONE = 0xFFFFFFFF;
+
+        struct Node {
+            uint32_t nw, ne, sw, se; // Children, for level 0 nodes all of them are NONE
+            uint32_t result = NONE;  // Center advanced by 2^result_step generations (level - 1)
+            uint8_t level;
+            uint8_t result_step = 0;
+            uint64_t population;
+        };
+
+        std::vector<Node> nodes;     // Index 0 is the dead cell and index 1 the live cell
+        std::vector<uint32_t> table; // Open addressing hash table of node indices
+        std::vector<uint32_t> empty_nodes;
+        size_t table_used = 0;
+        size_t memory_limit = (size_t)1 << 30;
+        size_t peak_memory = 0;
+        int max_jump = 0;                // advance_pow2() splits larger jumps, see there
+        std::vector<uint32_t> pinned;    // Nodes collect_garbage() keeps (and renumbers) besides the root
+        uint32_t root = NONE;
+        uint64_t generation = 0;
+        bool unchanged = false;
+
+        static uint64_t hash(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se);
+        uint32_t join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se);
+        uint32_t empty(int level);
+        uint32_t centre(uint32_t n);
+        uint32_t expand(uint32_t n);
+        bool is_centred(uint32_t n) const;
+        uint32_t trimmed(uint32_t n);
+        uint32_t base_result(uint32_t n);
+        uint32_t result(uint32_t n, int step);
+        void grow_table();
+        void collect_garbage();
+        uint32_t build(int level, int64_t x, int64_t y, const std::vector<uint8_t>& map, int height, int width);
+        void write(uint32_t n, int64_t x, int64_t y, std::vector<uint8_t>& map, int height, int width) const;
+        uint64_t count(uint32_t n, int64_t x, int64_t y, int64_t x0, int64_t y0, int64_t x1, int64_t y1) const;
+
+    public:
+        Hashlife();
+        void set_memory_limit(size_t bytes) {memory_limit = bytes;} // Node cache is collected above this size
+        void import_world(const std::vector<uint8_t>& map, int height, int width); // Cell (0,0) is the origin
+        void export_world(std::vector<uint8_t>& map, int height, int width) const;
+        void advance_pow2(int k);  // Advances exactly 2^k generations in one call
+        void advance(uint64_t gens); // Splits gens into powers of two
+        bool is_unchanged() const {return unchanged;} // The last advance did not change the world
+        uint64_t get_generation() const {return generation;}
+        uint64_t get_population() const;
+        uint64_t get_population(int64_t x0, int64_t y0, int64_t x1, int64_t y1) const; // Live cells in [x0, x1) x [y0, y1)
+        size_t get_node_count() const {return nodes.size();}
+        size_t get_memory_usage() const;
+        size_t get_peak_memory_usage() const {return peak_memory;} // Since the last import_world()
+};
+
+#endif //HASHLIFE_H
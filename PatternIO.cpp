@@ -0,0 +1,251 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include "../include/PatternIO.h"
+
+namespace {
+
+struct BoundingBox {
+    int x0, y0, x1, y1; // Inclusive
+    bool empty;
+};
+
+BoundingBox bounding_box(const std::vector<uint8_t>& map, int height, int width) {
+    BoundingBox box = {width, height, -1, -1, true};
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = map.data() + (size_t)y * width;
+        const uint8_t* first = std::find_if(row, row + width, [](uint8_t c) { return c != 0; });
+        if (first == row + width) {
+            continue;
+        }
+        const uint8_t* last = std::find_if(std::make_reverse_iterator(row + width), std::make_reverse_iterator(row),
+                                           [](uint8_t c) { return c != 0; }).base() - 1;
+        box.x0 = std::min(box.x0, (int)(first - row));
+        box.x1 = std::max(box.x1, (int)(last - row));
+        box.y0 = std::min(box.y0, y);
+        box.y1 = y;
+        box.empty = false;
+    }
+    return box;
+}
+
+// Keeps the RLE lines at most 70 characters long like Golly does
+class RleWriter {
+    std::ostream& out;
+    size_t line = 0;
+
+public:
+    explicit RleWriter(std::ostream& o) : out(o) {}
+
+    void put(int64_t count, const std::string& tag) {
+        if (count <= 0) {
+            return;
+        }
+        std::string item = (count > 1 ? std::to_string(count) : "") + tag;
+        if (line + item.size() > 70) {
+            out << "\n";
+            line = 0;
+        }
+        out << item;
+        line += item.size();
+    }
+};
+
+std::string state_tag(uint8_t state, bool multi_state) {
+    if (!multi_state) {
+        return state ? "o" : "b";
+    }
+    if (state == 0) {
+        return ".";
+    }
+    if (state <= 24) {
+        return std::string(1, (char)('A' + state - 1));
+    }
+    return std::string(1, (char)('p' + (state - 25) / 24)) + (char)('A' + (state - 25) % 24);
+}
+
+} // namespace
+
+PatternInfo read_rle(std::istream& in, const LiveRunCallback& live) {
+    PatternInfo info;
+    std::string header;
+
+    // Comments (#) come before the header line "x = m, y = n, rule = abc"
+    while (std::getline(in, header)) {
+        if (!header.empty() && header[0] == '#') {
+            continue;
+        }
+        if (header.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        break;
+    }
+
+    std::string compact;
+    std::remove_copy_if(header.begin(), header.end(), std::back_inserter(compact), [](char c) { return std::isspace((unsigned char)c); });
+    if (compact.rfind("x=", 0) != 0) {
+        throw std::runtime_error("Invalid RLE header: " + header);
+    }
+    std::stringstream fields(compact);
+    std::string field;
+    while (std::getline(fields, field, ',')) {
+        size_t eq = field.find('=');
+        if (eq == std::string::npos) {
+            continue;
+        }
+        std::string key = field.substr(0, eq), value = field.substr(eq + 1);
+        if (key == "x") {
+            info.width = std::stoll(value);
+        } else if (key == "y") {
+            info.height = std::stoll(value);
+        } else if (key == "rule") {
+            info.rule = value;
+        }
+    }
+
+    // The body is read one character at a time, only the current run count is kept
+    int64_t x = 0, y = 0, count = 0;
+    char c;
+    while (in.get(c)) {
+        if (std::isdigit((unsigned char)c)) {
+            count = count * 10 + (c - '0');
+            continue;
+        }
+        int64_t n = count ? count : 1;
+        count = 0;
+        if (c == '!') {
+            break;
+        } else if (c == '$') {
+            y += n;
+            x = 0;
+        } else if (c == 'b' || c == '.') {
+            x += n;
+        } else if (std::isalpha((unsigned char)c)) {
+            // 'o' (and any other letter of two-state patterns) is alive, 'A' to 'X' with an optional 'p' to 'y' in front are the states of multi-state patterns
+            int state = 1;
+            if (c >= 'A' && c <= 'X') {
+                state = c - 'A' + 1;
+            } else if (c >= 'p' && c <= 'y' && in.peek() >= 'A' && in.peek() <= 'X') {
+                state = 24 * (c - 'p' + 1) + (in.get() - 'A' + 1);
+            }
+            if (state > 255) {
+                throw std::runtime_error("RLE state out of range: " + std::to_string(state));
+            }
+            live(x, y, n, (uint8_t)state);
+            x += n;
+        } else if (c == '#') {
+            std::string ignored;
+            std::getline(in, ignored);
+        } else if (!std::isspace((unsigned char)c)) {
+            throw std::runtime_error(std::string("Invalid character in RLE data: ") + c);
+        }
+    }
+    return info;
+}
+
+PatternInfo read_cells(std::istream& in, const LiveRunCallback& live) {
+    PatternInfo info;
+    std::string line;
+    int64_t y = 0;
+
+    while (std::getline(in, line)) {
+        if (!line.empty() && line[0] == '!') {
+            continue;
+        }
+        int64_t x = 0, width = 0;
+        while (x < (int64_t)line.size()) {
+            char c = line[x];
+            if (c == 'O' || c == 'o' || c == '*') {
+                int64_t start = x;
+                while (x < (int64_t)line.size() && (line[x] == 'O' || line[x] == 'o' || line[x] == '*')) {
+                    x++;
+                }
+                live(start, y, x - start, 1);
+                width = x;
+            } else if (c == '.' || c == '\r' || c == ' ') {
+                x++;
+            } else {
+                throw std::runtime_error(std::string("Invalid character in .cells data: ") + c);
+            }
+        }
+        info.width = std::max(info.width, width);
+        y++;
+    }
+    info.height = y;
+    return info;
+}
+
+bool write_rle(std::ostream& out, const std::vector<uint8_t>& map, int height, int width, const std::string& rule, int states) {
+    BoundingBox box = bounding_box(map, height, width);
+    bool multi_state = states > 2 || std::any_of(map.begin(), map.end(), [](uint8_t c) { return c > 1; });
+    if (box.empty) {
+        out << "x = 0, y = 0, rule = " << rule << "\n!\n";
+        return false;
+    }
+
+    out << "#C Offset " << box.x0 << " " << box.y0 << " in a " << height << "x" << width << " world\n";
+    out << "x = " << (box.x1 - box.x0 + 1) << ", y = " << (box.y1 - box.y0 + 1) << ", rule = " << rule << "\n";
+
+    RleWriter writer(out);
+    int64_t empty_rows = 0;
+    for (int y = box.y0; y <= box.y1; ++y) {
+        const uint8_t* row = map.data() + (size_t)y * width;
+        // Dead cells at the end of a row and empty rows are never written
+        int end = box.x1;
+        while (end >= box.x0 && row[end] == 0) {
+            end--;
+        }
+        if (end < box.x0) {
+            empty_rows++;
+            continue;
+        }
+        if (y > box.y0) {
+            writer.put(empty_rows + 1, "$");
+        }
+        empty_rows = 0;
+
+        int x = box.x0;
+        while (x <= end) {
+            uint8_t state = multi_state ? row[x] : row[x] != 0;
+            int start = x;
+            while (x <= end && (multi_state ? row[x] : row[x] != 0) == state) {
+                x++;
+            }
+            writer.put(x - start, state_tag(state, multi_state));
+        }
+    }
+    out << "!\n";
+    return true;
+}
+
+bool write_cells(std::ostream& out, const std::vector<uint8_t>& map, int height, int width) {
+    if (std::any_of(map.begin(), map.end(), [](uint8_t c) { return c > 1; })) {
+        throw std::runtime_error("The .cells format only holds two states, save the world as .rle or .bin");
+    }
+    BoundingBox box = bounding_box(map, height, width);
+    out << "!Name: world " << height << "x" << width << "\n";
+    if (box.empty) {
+        return false;
+    }
+    out << "!Offset " << box.x0 << " " << box.y0 << "\n";
+
+    std::string line;
+    for (int y = box.y0; y <= box.y1; ++y) {
+        const uint8_t* row = map.data() + (size_t)y * width;
+        line.assign(box.x1 - box.x0 + 1, '.');
+        for (int x = box.x0; x <= box.x1; ++x) {
+            if (row[x]) {
+                line[x - box.x0] = 'O';
+            }
+        }
+        line.erase(line.find_last_not_of('.') + 1);
+        out << line << "\n";
+    }
+    return true;
+}
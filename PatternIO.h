@@ -0,0 +1,35 @@
+#ifndef PATTERNIO_H
+#define PATTERNIO_H
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
++ Streaming readers and writers for the RLE (Golly) and plaintext (.cells) pattern formats.
++ The readers never build the pattern in memory, every run of live cells is handed to the callback with
++ its position relative to the top-left corner of the pattern. The writers only store the bounding box of
++ the live cells of the world.
++ Worlds of Generations rules are written as multi-state RLE like Golly does: '.' is dead, 'A' to 'X' are
++ the states 1 to 24 and 'p' to 'y' in front of them add 24 * (1 to 10). .cells only holds two states.
+*/
+using LiveRunCallback = std::function<void(int64_t x, int64_t y, int64_t length, uint8_t state)>;
+
+struct PatternInfo {
+    int64_t width = 0, height = 0; // Size declared in the header (RLE) or read (.cells)
+    std::string rule;              // Empty if the pattern does not declare one
+};
+
+PatternInfo read_rle(std::istream& in, const LiveRunCallback& live);
+PatternInfo read_cells(std::istream& in, const LiveRunCallback& live);
+
+// Returns false if the world has no live cells (nothing but the header is written)
+// The multi-state letters are used when the rule has more than 2 states or the world has cells above 1
+bool write_rle(std::ostream& out, const std::vector<uint8_t>& map, int height, int width, const std::string& rule = "B3/S23", int states = 2);
+// Throws std::runtime_error, before anything is written, when the world has cells above 1
+bool write_cells(std::ostream& out, const std::vector<uint8_t>& map, int height, int width);
+
+#endif //PATTERNIO_H
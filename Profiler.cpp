@@ -0,0 +1,94 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include "../include/Profiler.h"
+
+Profiler& Profiler::get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::enable(bool on) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (on && !active) {
+        origin = std::chrono::steady_clock::now();
+        device_synced = false;
+    }
+    active = on;
+}
+
+void Profiler::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    events.clear();
+    origin = std::chrono::steady_clock::now();
+    device_synced = false;
+}
+
+void Profiler::record(const char* name, const char* category, std::chrono::steady_clock::time_point start,
+                      std::chrono::steady_clock::time_point end) {
+    std::lock_guard<std::mutex> guard(lock);
+    double ts = std::chrono::duration<double, std::micro>(start - origin).count();
+    double dur = std::chrono::duration<double, std::micro>(end - start).count();
+    events.push_back({name, category, 'X', 0, ts, dur});
+}
+
+void Profiler::record_device(const char* name, uint64_t start_ns, uint64_t end_ns, std::chrono::steady_clock::time_point completed_at) {
+    std::lock_guard<std::mutex> guard(lock);
+    /*
+    + The device has its own clock, the first event that is recorded ties the two clocks together by
+    + assuming it finished when the host saw it finish. Later device events keep their relative timing.
+    */
+    int64_t host_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(completed_at - origin).count();
+    if (!device_synced) {
+        device_offset_ns = host_ns - (int64_t)end_ns;
+        device_synced = true;
+    }
+    double ts = ((int64_t)start_ns + device_offset_ns) / 1e3;
+    double dur = (end_ns - start_ns) / 1e3;
+    events.push_back({name, "device", 'X', 1, ts, dur});
+}
+
+void Profiler::count(const char* name, double value) {
+    std::lock_guard<std::mutex> guard(lock);
+    double ts = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+    events.push_back({name, "counter", 'C', 0, ts, value});
+}
+
+std::vector<std::pair<std::string, double>> Profiler::totals() {
+    std::lock_guard<std::mutex> guard(lock);
+    std::map<std::string, double> sums;
+    for (const Event& e : events) {
+        if (e.phase == 'X') {
+            sums[e.name] += e.dur_us / 1e6;
+        }
+    }
+    return std::vector<std::pair<std::string, double>>(sums.begin(), sums.end());
+}
+
+bool Profiler::write_chrome_trace(const std::string& path) {
+    std::lock_guard<std::mutex> guard(lock);
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"host\"}},\n";
+    file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"device\"}}";
+    for (const Event& e : events) {
+        file << ",\n{\"name\": \"" << e.name << "\", \"cat\": \"" << e.category << "\", \"ph\": \"" << e.phase
+             << "\", \"pid\": 1, \"tid\": " << e.track << ", \"ts\": " << e.ts_us;
+        if (e.phase == 'X') {
+            file << ", \"dur\": " << e.dur_us << "}";
+        } else {
+            file << ", \"args\": {\"value\": " << e.dur_us << "}}";
+        }
+    }
+    file << "\n]}\n";
+    return true;
+}
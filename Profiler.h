@@ -0,0 +1,85 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
++ Lightweight instrumentation of the hot path. When the profiler is disabled a scoped timer only reads one
++ bool, with -DGOL_NO_PROFILING the PROFILE_SCOPE macro disappears completely.
++ The events are written in the Chrome trace-event format (chrome://tracing, Perfetto).
+*/
+class Profiler {
+    private:
+        struct Event {
+            std::string name;
+            const char* category;
+            char phase;     // 'X' complete event, 'C' counter
+            int track;      // 0 host, 1 device
+            double ts_us;   // Start in microseconds since the profiler was enabled
+            double dur_us;  // Duration ('X') or value ('C')
+        };
+
+        bool active = false;
+        std::chrono::steady_clock::time_point origin;
+        int64_t device_offset_ns = 0; // Device clock to host clock
+        bool device_synced = false;
+        std::vector<Event> events;
+        std::mutex lock;
+
+        Profiler() = default;
+
+    public:
+        static Profiler& get();
+
+        void enable(bool on);
+        bool enabled() const {return active;}
+        void clear();
+
+        void record(const char* name, const char* category, std::chrono::steady_clock::time_point start,
+                    std::chrono::steady_clock::time_point end);
+        // Device timestamps (e.g. OpenCL profiling info) in ns, completed_at is when the host saw them finish
+        void record_device(const char* name, uint64_t start_ns, uint64_t end_ns, std::chrono::steady_clock::time_point completed_at);
+        void count(const char* name, double value);
+
+        // Sum of the durations per event name in seconds
+        std::vector<std::pair<std::string, double>> totals();
+        bool write_chrome_trace(const std::string& path);
+};
+
+class ScopedTimer {
+    private:
+        const char* name;
+        const char* category;
+        bool on;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        ScopedTimer(const char* n, const char* c = "host") : name(n), category(c), on(Profiler::get().enabled()) {
+            if (on) {
+                start = std::chrono::steady_clock::now();
+            }
+        }
+        ~ScopedTimer() {stop();}
+        void stop() { // Ends the scope early, later calls do nothing
+            if (on) {
+                Profiler::get().record(name, category, start, std::chrono::steady_clock::now());
+                on = false;
+            }
+        }
+};
+
+#ifdef GOL_NO_PROFILING
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNT(name, value)
+#else
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ScopedTimer PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_COUNT(name, value) do { if (Profiler::get().enabled()) Profiler::get().count(name, value); } while (0)
+#endif
+
+#endif //PROFILER_H
@@ -0,0 +1,241 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "../include/Renderer.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* LIVE = "\033[32mX\033[0m ";
+const char* DEAD = "\033[90mO\033[0m ";
+// Density of a block from empty to full, the first step is any live cell so a lone glider does not disappear
+const char RAMP[] = " .:-=+*#%@";
+const int LEVELS = sizeof(RAMP) - 2;
+
+struct termios saved_terminal; // One terminal per process, restored when the renderer stops
+
+int wrap(int v, int n) {
+    return ((v % n) + n) % n;
+}
+
+} // namespace
+
+void Renderer::start(int interval_ms) {
+    stop();
+    frame_ms = std::max(0, interval_ms);
+    frames = dropped = 0;
+    pending = false;
+    running = true;
+    // Keys are read without waiting for enter and without echo, only when stdin is a terminal
+    raw_terminal = isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved_terminal) == 0;
+    if (raw_terminal) {
+        struct termios raw = saved_terminal;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    }
+    fputs("\033[2J\033[?25l", stdout);
+    fflush(stdout);
+    worker = std::thread(&Renderer::loop, this);
+}
+
+void Renderer::finish(const std::vector<uint8_t>& map, int height, int width, uint64_t generation, size_t population) {
+    if (!worker.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        // Replaces a snapshot that was not drawn yet, the last state is what should stay on the screen
+        copy_view(map.data(), height, width);
+        snapshot_generation = generation;
+        snapshot_population = population;
+        pending = true;
+    }
+    stop();
+}
+
+void Renderer::stop() {
+    if (!worker.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running = false;
+    }
+    wake.notify_all();
+    worker.join();
+    idle.store(false, std::memory_order_release);
+    if (raw_terminal) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved_terminal);
+        raw_terminal = false;
+    }
+    fputs("\033[?25h", stdout);
+    fflush(stdout);
+}
+
+bool Renderer::submit(const std::vector<uint8_t>& map, int height, int width, uint64_t generation, size_t population) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (pending || !running) {
+            return false;
+        }
+        idle.store(false, std::memory_order_release);
+        copy_view(map.data(), height, width);
+        snapshot_generation = generation;
+        snapshot_population = population;
+        pending = true;
+    }
+    wake.notify_all();
+    return true;
+}
+
+void Renderer::copy_view(const uint8_t* map, int height, int width) {
+    // Called with the lock held, a view larger than the world shows every cell once
+    Viewport v = view;
+    v.x = wrap(v.x, width);
+    v.y = wrap(v.y, height);
+    int lines = std::min(v.rows * v.block, height);
+    int cells = std::min(v.cols * v.block, width);
+    snapshot.resize((size_t)lines * cells);
+    int first = std::min(cells, width - v.x); // Cells before the right edge, the rest wraps to column 0
+    for (int r = 0; r < lines; ++r) {
+        const uint8_t* row = map + (size_t)wrap(v.y + r, height) * width;
+        uint8_t* out = snapshot.data() + (size_t)r * cells;
+        memcpy(out, row + v.x, first);
+        memcpy(out + first, row, cells - first);
+    }
+    v.rows = (lines + v.block - 1) / v.block;
+    v.cols = (cells + v.block - 1) / v.block;
+    snapshot_lines = lines;
+    snapshot_cells = cells;
+    view.x = v.x;
+    view.y = v.y;
+    snapshot_view = v;
+    world_height = height;
+    world_width = width;
+}
+
+void Renderer::loop() {
+    auto next_frame = Clock::now();
+    uint64_t last_generation = 0;
+    std::unique_lock<std::mutex> guard(lock);
+    while (running || pending) {
+        if (!pending) {
+            guard.unlock();
+            read_keys();
+            guard.lock();
+            auto now = Clock::now();
+            idle.store(running && now >= next_frame, std::memory_order_release);
+            // Wakes up for a snapshot, and at least every 50ms to read the keys
+            wake.wait_until(guard, std::min(now + std::chrono::milliseconds(50), std::max(now, next_frame)),
+                            [this]() {return pending || !running;});
+            continue;
+        }
+        std::swap(snapshot, drawing);
+        Viewport v = snapshot_view;
+        int lines = snapshot_lines, cells = snapshot_cells;
+        uint64_t generation = snapshot_generation;
+        size_t population = snapshot_population;
+        pending = false;
+        guard.unlock();
+
+        if (frames > 0 && generation > last_generation) {
+            dropped += generation - last_generation - 1;
+        }
+        last_generation = generation;
+        draw(v, lines, cells, generation, population);
+        frames++;
+        next_frame = Clock::now() + std::chrono::milliseconds(frame_ms);
+        guard.lock();
+    }
+}
+
+void Renderer::draw(const Viewport& v, int lines, int cells, uint64_t generation, size_t population) {
+    frame.clear();
+    frame += "\033[H";
+    for (int r = 0; r < v.rows; ++r) {
+        if (v.block == 1) {
+            const uint8_t* row = drawing.data() + (size_t)r * cells;
+            for (int c = 0; c < cells; ++c) {
+                frame += row[c] ? LIVE : DEAD;
+            }
+        } else {
+            int r0 = r * v.block, r1 = std::min(r0 + v.block, lines);
+            for (int c = 0; c < v.cols; ++c) {
+                int c0 = c * v.block, c1 = std::min(c0 + v.block, cells);
+                int live = 0;
+                for (int y = r0; y < r1; ++y) {
+                    const uint8_t* row = drawing.data() + (size_t)y * cells;
+                    for (int x = c0; x < c1; ++x) {
+                        live += row[x] == 1;
+                    }
+                }
+                int n = (r1 - r0) * (c1 - c0);
+                char shade = RAMP[live ? 1 + (live * (LEVELS - 1)) / n : 0];
+                frame += shade;
+                frame += shade; // Two characters per block like the cells, so the blocks are about square
+            }
+        }
+        frame += "\033[K\n";
+    }
+    char status[256];
+    snprintf(status, sizeof(status),
+             "Generation %llu, %zu live | view at (%d, %d), %dx%d cells per character | frame %zu, %zu generations skipped%s\033[K\n\033[J",
+             (unsigned long long)generation, population, v.x, v.y, v.block, v.block, frames + 1, dropped,
+             raw_terminal ? " | w/a/s/d scroll, +/- zoom" : "");
+    frame += status;
+    fwrite(frame.data(), 1, frame.size(), stdout);
+    fflush(stdout);
+}
+
+void Renderer::read_keys() {
+    if (!raw_terminal) {
+        return;
+    }
+    struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+    char keys[64];
+    ssize_t n = 0;
+    if (poll(&input, 1, 0) <= 0 || (n = read(STDIN_FILENO, keys, sizeof(keys))) <= 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    for (ssize_t k = 0; k < n; ++k) {
+        // A quarter of the view per key, in cells
+        int down = std::max(1, view.rows * view.block / 4), right = std::max(1, view.cols * view.block / 4);
+        switch (keys[k]) {
+            case 'w': view.y -= down; break;
+            case 's': view.y += down; break;
+            case 'a': view.x -= right; break;
+            case 'd': view.x += right; break;
+            case '+': view.block = std::max(1, view.block / 2); break;
+            case '-': view.block = std::min(1 << 12, view.block * 2); break;
+            default: break;
+        }
+    }
+    if (world_height > 0) {
+        view.x = wrap(view.x, world_width);
+        view.y = wrap(view.y, world_height);
+    }
+}
+
+void Renderer::set_viewport(const Viewport& v) {
+    std::lock_guard<std::mutex> guard(lock);
+    view = v;
+    view.cols = std::max(1, view.cols);
+    view.rows = std::max(1, view.rows);
+    view.block = std::max(1, view.block);
+}
+
+Viewport Renderer::get_viewport() {
+    std::lock_guard<std::mutex> guard(lock);
+    return view;
+}
@@ -0,0 +1,74 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Part of the torus that is drawn, with block > 1 every character is the density of a block x block square
+struct Viewport {
+    int x = 0, y = 0; // Top-left cell, wraps around the world
+    int cols = 64, rows = 32; // Cells (or blocks) per line and lines of the frame, a cell takes two characters
+    int block = 1;
+};
+
+/*
++ Draws the world on its own thread so the simulation never waits for the terminal.
++ The simulation asks wants_frame() after a generation (one atomic load) and only then writes its state back and
++ hands the cells of the viewport over with submit(); every other generation is skipped (a dropped frame).
++ A frame is built in one string and written with one call, it starts with the cursor at home instead of clearing
++ the screen so it does not flicker. While running on a terminal the view is moved with w/a/s/d and zoomed with +/-.
+*/
+class Renderer {
+    private:
+        std::thread worker;
+        std::mutex lock;
+        std::condition_variable wake;
+        std::atomic<bool> idle{false}; // Waiting for a frame and the frame interval has passed
+        bool running = false;
+        bool pending = false; // A snapshot was submitted and not drawn yet
+        Viewport view;
+        int frame_ms = 200; // Shortest time between two frames
+        // Snapshot of the viewport, view.rows * block lines of view.cols * block cells, swapped with drawing
+        std::vector<uint8_t> snapshot, drawing;
+        Viewport snapshot_view; // Rows and columns of characters that fit the world
+        int snapshot_lines = 0, snapshot_cells = 0;
+        int world_height = 0, world_width = 0;
+        uint64_t snapshot_generation = 0;
+        size_t snapshot_population = 0;
+        size_t frames = 0, dropped = 0;
+        std::string frame;
+        bool raw_terminal = false;
+
+        void loop();
+        void draw(const Viewport& v, int lines, int cells, uint64_t generation, size_t population);
+        void read_keys(); // Scrolls and zooms the view with the keys typed since the last call
+        void copy_view(const uint8_t* map, int height, int width);
+
+    public:
+        Renderer() = default;
+        ~Renderer() {stop();}
+        Renderer(const Renderer&) = delete;
+        Renderer& operator=(const Renderer&) = delete;
+
+        void start(int interval_ms);
+        // Draws the last state and waits for the thread, the view keeps the position it was scrolled to
+        void finish(const std::vector<uint8_t>& map, int height, int width, uint64_t generation, size_t population);
+        void stop();
+
+        bool wants_frame() const {return idle.load(std::memory_order_acquire);}
+        // Copies the viewport out of map, false (and nothing copied) when the last frame is still being drawn
+        bool submit(const std::vector<uint8_t>& map, int height, int width, uint64_t generation, size_t population);
+
+        void set_viewport(const Viewport& v);
+        Viewport get_viewport();
+        size_t get_frames() {return frames;} // Of the last run
+        size_t get_dropped() {return dropped;} // Generations that were never drawn between the first and last frame
+};
+
+#endif //RENDERER_H
@@ -0,0 +1,412 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+#include "../include/Rule.h"
+#include "../include/Stencil.h"
+
+namespace {
+
+std::vector<std::string> split(const std::string& s, char separator) {
+    std::vector<std::string> parts;
+    std::string part;
+    std::stringstream ss(s);
+    while (std::getline(ss, part, separator)) {
+        parts.push_back(part);
+    }
+    if (!s.empty() && s.back() == separator) {
+        parts.push_back("");
+    }
+    return parts;
+}
+
+int parse_number(const std::string& s, const std::string& rulestring) {
+    if (s.empty() || !std::all_of(s.begin(), s.end(), ::isdigit) || s.size() > 6) {
+        throw std::invalid_argument("Invalid number '" + s + "' in rule " + rulestring);
+    }
+    return std::stoi(s);
+}
+
+void finish(Rule& rule) {
+    // Masks and the canonical name of range 1 Moore rules
+    std::string b, s;
+    rule.birth_mask = rule.survive_mask = 0;
+    for (int n = 0; n <= rule.max_neighbors() && n < 32; ++n) {
+        if (rule.birth[n]) {
+            rule.birth_mask |= 1u << n;
+            b += (char)('0' + n);
+        }
+        if (rule.survive[n]) {
+            rule.survive_mask |= 1u << n;
+            s += (char)('0' + n);
+        }
+    }
+    rule.name = "B" + b + "/S" + s + (rule.states > 2 ? "/C" + std::to_string(rule.states) : "");
+}
+
+Rule parse_totalistic(const std::string& u, const std::string& rulestring) {
+    std::vector<std::string> parts = split(u, '/');
+    bool lettered = u.find('B') != std::string::npos || u.find('S') != std::string::npos;
+    if (parts.size() == 1 && lettered) {
+        // B3S23 without the slash
+        size_t second = u.find_first_of("BS", 1);
+        if (second == std::string::npos) {
+            throw std::invalid_argument("Invalid rule " + rulestring);
+        }
+        parts = {u.substr(0, second), u.substr(second)};
+    }
+    if (parts.size() < 2 || parts.size() > 3) {
+        throw std::invalid_argument("Invalid rule " + rulestring);
+    }
+
+    std::string birth, survive, states;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        const std::string& p = parts[i];
+        char section = (!p.empty() && std::isalpha((unsigned char)p[0])) ? p[0] : 0;
+        std::string digits = section ? p.substr(1) : p;
+        if (!section) {
+            // Without letters the order is S/B/C, with letters an unlabeled third part is C
+            section = lettered ? (i == 2 ? 'C' : 0) : "SBC"[i];
+        }
+        switch (section) {
+            case 'B': birth = digits; break;
+            case 'S': survive = digits; break;
+            case 'C': case 'G': states = digits; break;
+            default: throw std::invalid_argument("Invalid rule " + rulestring);
+        }
+    }
+
+    Rule rule;
+    rule.birth.assign(9, 0);
+    rule.survive.assign(9, 0);
+    for (char c : birth) {
+        if (c < '0' || c > '8') throw std::invalid_argument("Invalid birth count in rule " + rulestring);
+        rule.birth[c - '0'] = 1;
+    }
+    for (char c : survive) {
+        if (c < '0' || c > '8') throw std::invalid_argument("Invalid survival count in rule " + rulestring);
+        rule.survive[c - '0'] = 1;
+    }
+    if (!states.empty()) {
+        rule.states = std::max(2, parse_number(states, rulestring));
+        if (rule.states > 255) {
+            throw std::invalid_argument("At most 255 states are supported, rule " + rulestring);
+        }
+    }
+    finish(rule);
+    return rule;
+}
+
+Rule parse_ltl(const std::string& u, const std::string& rulestring) {
+    // R<range>,C<states>,M<0|1>,S<min>..<max>,B<min>..<max>,N<M|N>
+    Rule rule;
+    int s_min = -1, s_max = -1, b_min = -1, b_max = -1;
+    auto range_of = [&](const std::string& v, int& lo, int& hi) {
+        size_t dots = v.find("..");
+        lo = parse_number(v.substr(0, dots), rulestring);
+        hi = dots == std::string::npos ? lo : parse_number(v.substr(dots + 2), rulestring);
+    };
+    for (const std::string& token : split(u, ',')) {
+        if (token.empty()) {
+            continue;
+        }
+        std::string value = token.substr(1);
+        switch (token[0]) {
+            case 'R': rule.range = parse_number(value, rulestring); break;
+            case 'C': rule.states = std::max(2, parse_number(value, rulestring)); break;
+            case 'M': rule.count_middle = parse_number(value, rulestring) != 0; break;
+            case 'S': range_of(value, s_min, s_max); break;
+            case 'B': range_of(value, b_min, b_max); break;
+            case 'N':
+                if (value != "M" && value != "N") throw std::invalid_argument("Unknown neighborhood in rule " + rulestring);
+                rule.von_neumann = (value == "N");
+                break;
+            default: throw std::invalid_argument("Invalid rule " + rulestring);
+        }
+    }
+    if (rule.range < 1 || rule.range > 50 || rule.states > 255) {
+        throw std::invalid_argument("Range must be 1 to 50 and states at most 255, rule " + rulestring);
+    }
+
+    int r = rule.range;
+    int cells = rule.von_neumann ? 2 * r * (r + 1) + 1 : (2 * r + 1) * (2 * r + 1);
+    rule.birth.assign(cells + 1, 0);
+    rule.survive.assign(cells + 1, 0);
+    for (int n = std::max(0, b_min); b_min >= 0 && n <= std::min(b_max, cells); ++n) rule.birth[n] = 1;
+    for (int n = std::max(0, s_min); s_min >= 0 && n <= std::min(s_max, cells); ++n) rule.survive[n] = 1;
+
+    if (r == 1 && !rule.von_neumann) {
+        // Range 1 Moore is a B/S rule, with M1 a live cell counts itself
+        if (rule.count_middle) {
+            std::vector<uint8_t> survive(10, 0);
+            for (int n = 0; n < 9; ++n) survive[n] = rule.survive[n + 1];
+            rule.survive = survive;
+            rule.count_middle = false;
+        }
+        rule.birth.resize(9);
+        rule.survive.resize(9);
+        finish(rule);
+        return rule;
+    }
+
+    auto bounds = [](int lo, int hi) {
+        return lo < 0 ? std::string("") : std::to_string(lo) + ".." + std::to_string(hi);
+    };
+    rule.name = "R" + std::to_string(r) + ",C" + std::to_string(rule.states > 2 ? rule.states : 0)
+              + ",M" + (rule.count_middle ? "1" : "0") + ",S" + bounds(s_min, s_max) + ",B" + bounds(b_min, b_max)
+              + ",N" + (rule.von_neumann ? "N" : "M");
+    return rule;
+}
+
+/*
++ Range 1 kernel, apply(cell, n) is the transition. Plain (two state) rules can sum the bytes, with
++ Generations the dying states are not 1 and must not be counted.
+*/
+template <bool Plain, typename Apply>
+inline void span(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int width, int x0, int x1, Apply apply) {
+    auto live = [](uint8_t v) -> int { return Plain ? v : v == 1; };
+    auto count = [&](int l, int x, int r) {
+        return live(up[l]) + live(up[x]) + live(up[r]) + live(mid[l]) + live(mid[r]) + live(down[l]) + live(down[x]) + live(down[r]);
+    };
+
+    int begin = x0, end = x1;
+    if (begin == 0) {
+        out[0] = apply(mid[0], count((width - 1) % width, 0, 1 % width));
+        begin = 1;
+    }
+    if (end == width && end > begin) {
+        end = width - 1;
+    }
+    for (int x = begin; x < end; ++x) {
+        out[x] = apply(mid[x], count(x - 1, x, x + 1));
+    }
+    if (x1 == width && width > 1) {
+        out[width - 1] = apply(mid[width - 1], count(width - 2, width - 1, 0));
+    }
+}
+
+template <uint32_t Birth, uint32_t Survive, int States>
+void rule_kernel(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int width, int x0, int x1, const Rule&) {
+    span<States == 2>(up, mid, down, out, width, x0, x1, [](uint8_t cell, int n) -> uint8_t {
+        if (States == 2) {
+            return ((cell ? Survive : Birth) >> n) & 1;
+        }
+        if (cell == 0) {
+            return (Birth >> n) & 1;
+        }
+        if (cell == 1) {
+            return ((Survive >> n) & 1) ? 1 : 2;
+        }
+        return cell + 1 < States ? cell + 1 : 0;
+    });
+}
+
+void generic_kernel(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int width, int x0, int x1, const Rule& rule) {
+    const uint32_t birth = rule.birth_mask, survive = rule.survive_mask;
+    const int states = rule.states;
+    if (states == 2) {
+        span<true>(up, mid, down, out, width, x0, x1, [=](uint8_t cell, int n) -> uint8_t {
+            return ((cell ? survive : birth) >> n) & 1;
+        });
+        return;
+    }
+    span<false>(up, mid, down, out, width, x0, x1, [=](uint8_t cell, int n) -> uint8_t {
+        if (cell == 0) {
+            return (birth >> n) & 1;
+        }
+        if (cell == 1) {
+            return ((survive >> n) & 1) ? 1 : 2;
+        }
+        return cell + 1 < states ? cell + 1 : 0;
+    });
+}
+
+void life_kernel(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int width, int x0, int x1, const Rule&) {
+    evolve_span(up, mid, down, out, width, x0, x1);
+}
+
+constexpr uint32_t counts(const char* digits) {
+    uint32_t mask = 0;
+    for (; *digits; ++digits) {
+        mask |= 1u << (*digits - '0');
+    }
+    return mask;
+}
+
+struct KnownRule {
+    const char* name;
+    RuleSpanKernel kernel;
+};
+
+const KnownRule KNOWN_RULES[] = {
+    {"B3/S23", life_kernel},
+    {"B36/S23", rule_kernel<counts("36"), counts("23"), 2>},           // HighLife
+    {"B3678/S34678", rule_kernel<counts("3678"), counts("34678"), 2>}, // Day & Night
+    {"B2/S", rule_kernel<counts("2"), counts(""), 2>},                 // Seeds
+    {"B3/S012345678", rule_kernel<counts("3"), counts("012345678"), 2>}, // Life without death
+    {"B34/S34", rule_kernel<counts("34"), counts("34"), 2>},
+    {"B35678/S5678", rule_kernel<counts("35678"), counts("5678"), 2>}, // Diamoeba
+    {"B1357/S1357", rule_kernel<counts("1357"), counts("1357"), 2>},   // Replicator
+    {"B2/S/C3", rule_kernel<counts("2"), counts(""), 3>},              // Brian's Brain
+    {"B2/S345/C4", rule_kernel<counts("2"), counts("345"), 4>},        // Star Wars
+};
+
+} // namespace
+
+Rule parse_rule(const std::string& rulestring) {
+    std::string u;
+    for (char c : rulestring) {
+        if (!std::isspace((unsigned char)c)) {
+            u += (char)std::toupper((unsigned char)c);
+        }
+    }
+    if (u.empty()) {
+        throw std::invalid_argument("Empty rule");
+    }
+    if (u[0] == 'R' && u.find(',') != std::string::npos) {
+        return parse_ltl(u, rulestring);
+    }
+    return parse_totalistic(u, rulestring);
+}
+
+RuleSpanKernel select_rule_kernel(const Rule& rule, bool& specialized) {
+    for (const KnownRule& known : KNOWN_RULES) {
+        if (rule.name == known.name) {
+            specialized = true;
+            return known.kernel;
+        }
+    }
+    specialized = false;
+    return generic_kernel;
+}
+
+void evolve_ltl(const uint8_t* map, uint8_t* next, int height, int width, const Rule& rule) {
+    /*
+    + Prefix sums of the live cells of every row, the count of a cell is then one difference per row of the
+    + neighborhood instead of one read per cell: O(range) per cell instead of O(range^2).
+    */
+    const int r = rule.range;
+    const size_t stride = (size_t)width + 1;
+    std::vector<int> prefix((size_t)height * stride);
+
+    #pragma omp parallel for
+    for (int y = 0; y < height; ++y) {
+        int* p = prefix.data() + y * stride;
+        const uint8_t* row = map + (size_t)y * width;
+        p[0] = 0;
+        for (int x = 0; x < width; ++x) {
+            p[x + 1] = p[x] + (row[x] == 1);
+        }
+    }
+
+    // Live cells in the columns [x - reach, x + reach] of a row, on small worlds the span can wrap more than once
+    auto row_count = [&](const int* p, int x, int reach) {
+        int length = 2 * reach + 1;
+        int total = (length / width) * p[width];
+        length %= width;
+        int a = ((x - reach) % width + width) % width;
+        if (a + length <= width) {
+            return total + p[a + length] - p[a];
+        }
+        return total + p[width] - p[a] + p[a + length - width];
+    };
+
+    #pragma omp parallel for
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            int n = 0;
+            for (int dy = -r; dy <= r; ++dy) {
+                const int* p = prefix.data() + (size_t)(((y + dy) % height + height) % height) * stride;
+                n += row_count(p, x, rule.von_neumann ? r - std::abs(dy) : r);
+            }
+            uint8_t cell = map[(size_t)y * width + x];
+            if (!rule.count_middle && cell == 1) {
+                n--;
+            }
+            next[(size_t)y * width + x] = rule.next_state(cell, n);
+        }
+    }
+}
+
+std::string generate_opencl_source(const Rule& rule, int group_x, int group_y, int cells) {
+    auto table = [](const char* name, const std::vector<uint8_t>& values) {
+        std::string s = "__constant uchar " + std::string(name) + "[" + std::to_string(values.size()) + "] = {";
+        for (size_t i = 0; i < values.size(); ++i) {
+            s += (i ? "," : "") + std::to_string(values[i]);
+        }
+        return s + "};\n";
+    };
+
+    /*
+    + Every work-group loads its tile plus a RANGE cell halo into local memory once, the halo wraps around the
+    + torus. A work-item computes CELLS cells of its row that are GROUP_X apart, so neighboring work-items
+    + still write neighboring bytes. The global range is rounded up to whole groups and the cells outside of
+    + the world are skipped, so any height and width work.
+    + With check >= 0 the same launch finds out whether next differs from map (bit 0) and from older (bit 1):
+    + the work-items of a group collect their bits in local memory and only one of them ORs them into
+    + flags[check], so the generations of a batch each have their own flags.
+    */
+    std::ostringstream src;
+    src << "// Generated for the rule " << rule.name << "\n"
+        << "#define RANGE " << rule.range << "\n"
+        << "#define STATES " << rule.states << "\n"
+        << "#define GROUP_X " << group_x << "\n"
+        << "#define GROUP_Y " << group_y << "\n"
+        << "#define CELLS " << cells << "\n"
+        << "#define TILE_W (GROUP_X * CELLS + 2 * RANGE)\n"
+        << "#define TILE_H (GROUP_Y + 2 * RANGE)\n"
+        << table("birth", rule.birth) << table("survive", rule.survive)
+        << "__kernel __attribute__((reqd_work_group_size(GROUP_X, GROUP_Y, 1)))\n"
+        << "void evolve(__global const uchar* map, __global const uchar* older, __global uchar* next,\n"
+        << "            const int width, const int height, __global int* flags, const int check) {\n"
+        << "    __local uchar tile[TILE_H][TILE_W];\n"
+        << "    __local int group_changed;\n"
+        << "    const int lx = get_local_id(0);\n"
+        << "    const int ly = get_local_id(1);\n"
+        << "    const int x0 = get_group_id(0) * GROUP_X * CELLS;\n"
+        << "    const int y0 = get_group_id(1) * GROUP_Y;\n"
+        << "    if (lx == 0 && ly == 0) group_changed = 0;\n"
+        << "    for (int i = ly * GROUP_X + lx; i < TILE_H * TILE_W; i += GROUP_X * GROUP_Y) {\n"
+        << "        const int ty = i / TILE_W;\n"
+        << "        const int tx = i - ty * TILE_W;\n"
+        << "        const int yy = ((y0 + ty - RANGE) % height + height) % height;\n"
+        << "        const int xx = ((x0 + tx - RANGE) % width + width) % width;\n"
+        << "        tile[ty][tx] = map[yy * width + xx];\n"
+        << "    }\n"
+        << "    barrier(CLK_LOCAL_MEM_FENCE);\n"
+        << "    const int y = y0 + ly;\n"
+        << "    int changed = 0;\n"
+        << "    for (int c = 0; c < CELLS && y < height; ++c) {\n"
+        << "        const int tx = RANGE + c * GROUP_X + lx;\n"
+        << "        const int x = x0 + tx - RANGE;\n"
+        << "        if (x >= width) break;\n"
+        << "        int n = 0;\n"
+        << "        for (int dy = -RANGE; dy <= RANGE; ++dy) {\n"
+        << "            const int reach = " << (rule.von_neumann ? "RANGE - abs(dy)" : "RANGE") << ";\n"
+        << "            for (int dx = -reach; dx <= reach; ++dx) {\n"
+        << "                n += tile[ly + RANGE + dy][tx + dx] == 1;\n"
+        << "            }\n"
+        << "        }\n"
+        << "        const uchar cell = tile[ly + RANGE][tx];\n"
+        << (rule.count_middle ? "" : "        n -= (cell == 1);\n")
+        << "        uchar result;\n"
+        << "        if (cell == 0) result = birth[n];\n"
+        << "        else if (cell == 1) result = survive[n] ? 1 : (STATES > 2 ? 2 : 0);\n"
+        << "        else result = cell + 1 < STATES ? cell + 1 : 0;\n"
+        << "        next[y * width + x] = result;\n"
+        << "        if (check >= 0 && changed != 3) {\n"
+        << "            changed |= (result != cell) | ((result != older[y * width + x]) << 1);\n"
+        << "        }\n"
+        << "    }\n"
+        << "    if (check >= 0) {\n"
+        << "        if (changed) atomic_or(&group_changed, changed);\n"
+        << "        barrier(CLK_LOCAL_MEM_FENCE);\n"
+        << "        if (lx == 0 && ly == 0 && group_changed) atomic_or(flags + check, group_changed);\n"
+        << "    }\n"
+        << "}\n";
+    return src.str();
+}
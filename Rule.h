@@ -0,0 +1,61 @@
+#ifndef RULE_H
+#define RULE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
++ Outer totalistic rules: life-like (B3/S23, B36/S23, ...), Generations (B2/S/C3, cells that die go
++ through C-2 dying states and do not count as neighbors) and Larger than Life (R5,C0,M1,S34..58,B34..45,NM).
+*/
+struct Rule {
+    std::string name;          // Canonical rulestring
+    int range = 1;             // Neighborhood radius, larger than 1 only for Larger than Life
+    bool von_neumann = false;  // Diamond neighborhood instead of the Moore square
+    bool count_middle = false; // The cell itself is part of its own count (LtL M1)
+    int states = 2;            // 2 for plain rules, C for Generations
+    std::vector<uint8_t> birth, survive; // By number of live neighbors
+    uint32_t birth_mask = 0, survive_mask = 0; // Bit n is birth[n]/survive[n], only for range 1
+
+    bool is_life() const {return name == "B3/S23";}
+    bool is_ltl() const {return range > 1 || von_neumann;} // Needs evolve_ltl(), no range 1 kernel
+    int max_neighbors() const {return (int)birth.size() - 1;}
+
+    // Reference transition, the kernels below produce the same states
+    uint8_t next_state(uint8_t cell, int n) const {
+        if (cell == 0) {
+            return birth[n];
+        }
+        if (cell == 1) {
+            return survive[n] ? 1 : (states > 2 ? 2 : 0);
+        }
+        return cell + 1 < states ? cell + 1 : 0;
+    }
+};
+
+// Accepts B/S (B3/S23, b3s23), S/B (23/3), Generations (B2/S/C3, 345/2/4) and LtL (R2,C0,M1,S6..9,B7..8,NM)
+Rule parse_rule(const std::string& rulestring); // Throws std::invalid_argument
+
+/*
++ Kernel for the columns [x0, x1) of one row of a range 1 rule (same contract as evolve_span in Stencil.h).
++ The well known rules have their own instantiation with the masks as template parameters, every other
++ rule gets the generic kernel that reads the masks from the rule.
+*/
+using RuleSpanKernel = void (*)(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out,
+                                int width, int x0, int x1, const Rule& rule);
+RuleSpanKernel select_rule_kernel(const Rule& rule, bool& specialized);
+
+// Whole world step for any range (Larger than Life), rows are computed in parallel
+void evolve_ltl(const uint8_t* map, uint8_t* next, int height, int width, const Rule& rule);
+
+/*
++ OpenCL source of the "evolve" kernel for the rule (map, older, next, width, height, flags, check), staged in
++ local memory. With check >= 0 it ORs 1 into flags[check] when next differs from map and 2 when it differs
++ from older, a negative check skips the comparison.
++ It must be launched with work-groups of group_x * group_y work-items that compute cells cells each, the
++ global range is rounded up to whole groups (ceil(width / (group_x * cells)) * group_x, ceil(height / group_y) * group_y).
+*/
+std::string generate_opencl_source(const Rule& rule, int group_x, int group_y, int cells);
+
+#endif //RULE_H
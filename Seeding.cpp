@@ -0,0 +1,104 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <algorithm>
+#include <cmath>
+#include "../include/Seeding.h"
+
+namespace {
+
+struct Figure {
+    int cells;
+    int dx[6], dy[6];
+};
+
+// Same cells as case 0 of the old randomize() and addBeacon(), addToad(), addGlider(), addMethuselah()
+const Figure FIGURES[5] = {
+    {4, {0, 1, 2, -1}, {0, 0, 0, -1}},
+    {6, {0, 0, 1, 3, 3, 2}, {0, -1, 0, -3, -2, -3}},
+    {6, {0, 1, 1, 1, 0, 0}, {0, 1, -1, 0, -1, -2}},
+    {5, {0, 1, 1, 1, -1}, {1, -1, 0, 1, 0}},
+    {5, {0, -1, 0, 0, 1}, {0, 0, 1, -1, -1}},
+};
+const int MAX_FIGURE_CELLS = 6;
+
+// Streams of seed_figures(), stream 0 belongs to seed_random()
+enum : uint64_t {KIND = 1, COLUMN = 2, ROW = 3};
+
+} // namespace
+
+uint64_t density_threshold(double density) {
+    if (density <= 0.0) {
+        return 0;
+    }
+    if (density >= 1.0) {
+        return UINT64_MAX;
+    }
+    return (uint64_t)std::ldexp(density, 64);
+}
+
+double binary_entropy(size_t live, size_t cells) {
+    double entropy = 0.0;
+    for (size_t n : {live, cells - live}) {
+        double probability = (double)n / cells;
+        if (probability > 0) {
+            entropy -= probability * std::log2(probability);
+        }
+    }
+    return entropy;
+}
+
+size_t seed_random(uint8_t* map, size_t cells, uint64_t seed, double density, uint64_t stream) {
+    const uint64_t threshold = density_threshold(density);
+    const bool all = density >= 1.0;
+    size_t live = 0;
+    #pragma omp parallel for schedule(static) reduction(+:live)
+    for (size_t i = 0; i < cells; ++i) {
+        map[i] = all || random_at(seed, stream, i) < threshold;
+        live += map[i];
+    }
+    return live;
+}
+
+size_t seed_figures(uint8_t* map, int height, int width, uint64_t seed, double target_entropy, int max_figures, size_t& live) {
+    const size_t cells = (size_t)height * width;
+    const double goal = target_entropy + 0.01;
+
+    // Fewest live cells with enough entropy, the entropy only grows with the live cells up to half the world
+    size_t low = live, high = cells / 2 + 1;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        binary_entropy(mid, cells) >= goal ? high = mid : low = mid + 1;
+    }
+    const size_t target_live = low;
+    const bool reachable = target_live <= cells / 2;
+
+    size_t placed = 0;
+    while (placed < (size_t)max_figures && binary_entropy(live, cells) < goal) {
+        // A figure adds at most MAX_FIGURE_CELLS cells, fewer figures than the missing cells allow cannot
+        // reach the target before the last one. When it cannot be reached at all every figure is placed.
+        size_t round = (size_t)max_figures - placed;
+        if (reachable && live < target_live) {
+            round = std::min(round, (target_live - live + MAX_FIGURE_CELLS - 1) / MAX_FIGURE_CELLS);
+        }
+
+        size_t added = 0;
+        #pragma omp parallel for reduction(+:added)
+        for (size_t f = placed; f < placed + round; ++f) {
+            const Figure& figure = FIGURES[random_at(seed, KIND, f) % 5];
+            const int x = (int)(random_at(seed, COLUMN, f) % width);
+            const int y = (int)(random_at(seed, ROW, f) % height);
+            for (int c = 0; c < figure.cells; ++c) {
+                size_t i = (size_t)((y + figure.dy[c] + 3 * height) % height) * width + (x + figure.dx[c] + 3 * width) % width;
+                uint8_t old;
+                #pragma omp atomic capture
+                {old = map[i]; map[i] = 1;}
+                added += old != 1;
+            }
+        }
+        live += added;
+        placed += round;
+    }
+    return placed;
+}
@@ -0,0 +1,42 @@
+#ifndef SEEDING_H
+#define SEEDING_H
+
+#include <cstdint>
+#include <cstddef>
+
+/*
++ Counter based random numbers (splitmix64 finalizer): the number for (seed, stream, counter) is computed
++ directly instead of drawn from a generator state, so cells and figures can be produced in any order by
++ any number of threads and a seed always gives the same world.
+*/
+inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+inline uint64_t random_at(uint64_t seed, uint64_t stream, uint64_t counter) {
+    return splitmix64(splitmix64(seed ^ splitmix64(stream)) + counter * 0x9E3779B97F4A7C15ULL);
+}
+
+// random_at() < density_threshold(p) has probability p
+uint64_t density_threshold(double density);
+
+// Shannon entropy of a world with live cells out of cells, what get_entropy() returns for 0/1 worlds
+double binary_entropy(size_t live, size_t cells);
+
+// Every cell alive with probability density, cell i uses counter i of the stream. Returns the live cells.
+size_t seed_random(uint8_t* map, size_t cells, uint64_t seed, double density, uint64_t stream = 0);
+
+/*
++ Adds the figures of randomize() (the four cell figure, beacon, toad, glider and R-pentomino) at random
++ positions until the entropy is 0.01 above target_entropy or max_figures were added, returns the number
++ added. Figure i only depends on seed and i, and placing a figure only sets cells, so the figures are
++ placed in parallel rounds sized to never pass the target before the last figure of the round: the result
++ is the same as adding them one by one and checking the entropy after each, for any number of threads.
++ live must hold the live cells of map and is kept up to date while placing, the world is never scanned.
+*/
+size_t seed_figures(uint8_t* map, int height, int width, uint64_t seed, double target_entropy, int max_figures, size_t& live);
+
+#endif //SEEDING_H
@@ -0,0 +1,120 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <immintrin.h>
+#include "../include/SimdEvolve.h"
+
+// Border columns and the remainder of a row that does not fill a whole vector
+static inline void evolve_cell(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int width, int x) {
+    int l = (x + width - 1) % width;
+    int r = (x + 1) % width;
+    int n = up[l] + up[x] + up[r] + mid[l] + mid[r] + down[l] + down[x] + down[r];
+    out[x] = (n == 3) | (mid[x] & (n == 2));
+}
+
+static void evolve_row_scalar(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int width) {
+    for (int x = 0; x < width; ++x) {
+        evolve_cell(up, mid, down, out, width, x);
+    }
+}
+
+/*
++ All the kernels follow the same scheme: the 8 neighbors of V cells are summed with byte adds on the rows
++ loaded at x-1, x and x+1 (unaligned), the count is compared against 2 and 3 and the masks are combined
++ with the current state. Column 0 and width-1 are done by evolve_cell() because of the toroidal wrap.
+*/
+__attribute__((target("sse2")))
+static void evolve_row_sse(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int width) {
+    const __m128i two = _mm_set1_epi8(2), three = _mm_set1_epi8(3), one = _mm_set1_epi8(1);
+    evolve_cell(up, mid, down, out, width, 0);
+    int x = 1;
+    for (; x + 16 <= width - 1; x += 16) {
+        __m128i n = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(up + x - 1)), _mm_loadu_si128((const __m128i*)(up + x)));
+        n = _mm_add_epi8(n, _mm_loadu_si128((const __m128i*)(up + x + 1)));
+        n = _mm_add_epi8(n, _mm_loadu_si128((const __m128i*)(mid + x - 1)));
+        n = _mm_add_epi8(n, _mm_loadu_si128((const __m128i*)(mid + x + 1)));
+        n = _mm_add_epi8(n, _mm_loadu_si128((const __m128i*)(down + x - 1)));
+        n = _mm_add_epi8(n, _mm_loadu_si128((const __m128i*)(down + x)));
+        n = _mm_add_epi8(n, _mm_loadu_si128((const __m128i*)(down + x + 1)));
+        __m128i live = _mm_loadu_si128((const __m128i*)(mid + x));
+        __m128i born = _mm_and_si128(_mm_cmpeq_epi8(n, three), one);
+        __m128i stay = _mm_and_si128(_mm_cmpeq_epi8(n, two), live);
+        _mm_storeu_si128((__m128i*)(out + x), _mm_or_si128(born, stay));
+    }
+    for (; x < width; ++x) {
+        evolve_cell(up, mid, down, out, width, x);
+    }
+}
+
+__attribute__((target("avx2")))
+static void evolve_row_avx2(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int width) {
+    const __m256i two = _mm256_set1_epi8(2), three = _mm256_set1_epi8(3), one = _mm256_set1_epi8(1);
+    evolve_cell(up, mid, down, out, width, 0);
+    int x = 1;
+    for (; x + 32 <= width - 1; x += 32) {
+        __m256i n = _mm256_add_epi8(_mm256_loadu_si256((const __m256i*)(up + x - 1)), _mm256_loadu_si256((const __m256i*)(up + x)));
+        n = _mm256_add_epi8(n, _mm256_loadu_si256((const __m256i*)(up + x + 1)));
+        n = _mm256_add_epi8(n, _mm256_loadu_si256((const __m256i*)(mid + x - 1)));
+        n = _mm256_add_epi8(n, _mm256_loadu_si256((const __m256i*)(mid + x + 1)));
+        n = _mm256_add_epi8(n, _mm256_loadu_si256((const __m256i*)(down + x - 1)));
+        n = _mm256_add_epi8(n, _mm256_loadu_si256((const __m256i*)(down + x)));
+        n = _mm256_add_epi8(n, _mm256_loadu_si256((const __m256i*)(down + x + 1)));
+        __m256i live = _mm256_loadu_si256((const __m256i*)(mid + x));
+        __m256i born = _mm256_and_si256(_mm256_cmpeq_epi8(n, three), one);
+        __m256i stay = _mm256_and_si256(_mm256_cmpeq_epi8(n, two), live);
+        _mm256_storeu_si256((__m256i*)(out + x), _mm256_or_si256(born, stay));
+    }
+    for (; x < width; ++x) {
+        evolve_cell(up, mid, down, out, width, x);
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void evolve_row_avx512(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int width) {
+    const __m512i one = _mm512_set1_epi8(1), two = _mm512_set1_epi8(2), three = _mm512_set1_epi8(3);
+    evolve_cell(up, mid, down, out, width, 0);
+    int x = 1;
+    for (; x + 64 <= width - 1; x += 64) {
+        __m512i n = _mm512_add_epi8(_mm512_loadu_si512(up + x - 1), _mm512_loadu_si512(up + x));
+        n = _mm512_add_epi8(n, _mm512_loadu_si512(up + x + 1));
+        n = _mm512_add_epi8(n, _mm512_loadu_si512(mid + x - 1));
+        n = _mm512_add_epi8(n, _mm512_loadu_si512(mid + x + 1));
+        n = _mm512_add_epi8(n, _mm512_loadu_si512(down + x - 1));
+        n = _mm512_add_epi8(n, _mm512_loadu_si512(down + x));
+        n = _mm512_add_epi8(n, _mm512_loadu_si512(down + x + 1));
+        __m512i live = _mm512_loadu_si512(mid + x);
+        // AVX-512 compares produce mask registers, so the rule is a masked blend of 1 or the current state
+        __mmask64 born = _mm512_cmpeq_epi8_mask(n, three);
+        __mmask64 stay = _mm512_cmpeq_epi8_mask(n, two);
+        __m512i result = _mm512_maskz_mov_epi8(stay, live);
+        result = _mm512_mask_blend_epi8(born, result, one);
+        _mm512_storeu_si512(out + x, result);
+    }
+    for (; x < width; ++x) {
+        evolve_cell(up, mid, down, out, width, x);
+    }
+}
+
+SimdRowKernel select_simd_kernel(const std::string& isa, std::string& name) {
+    __builtin_cpu_init();
+    bool avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    bool avx2 = __builtin_cpu_supports("avx2");
+    bool sse = __builtin_cpu_supports("sse2");
+
+    // An instruction set that is not supported falls back to the next best one
+    if ((isa == "auto" || isa == "avx512") && avx512) {
+        name = "avx512";
+        return evolve_row_avx512;
+    }
+    if ((isa == "auto" || isa == "avx512" || isa == "avx2") && avx2) {
+        name = "avx2";
+        return evolve_row_avx2;
+    }
+    if (isa != "scalar" && sse) {
+        name = "sse";
+        return evolve_row_sse;
+    }
+    name = "scalar";
+    return evolve_row_scalar;
+}
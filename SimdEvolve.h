@@ -0,0 +1,17 @@
+#ifndef SIMDEVOLVE_H
+#define SIMDEVOLVE_H
+
+#include <cstdint>
+#include <string>
+
+/*
++ Hand vectorized B3/S23 kernels for one row of the byte per cell world. The project is compiled with
++ -fno-tree-vectorize -msse, so every instruction set gets its own function compiled with a target
++ attribute and the best one supported by the CPU is chosen at runtime.
+*/
+using SimdRowKernel = void (*)(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int width);
+
+// isa is "auto", "avx512", "avx2", "sse" or "scalar". The name of the selected kernel is written to name.
+SimdRowKernel select_simd_kernel(const std::string& isa, std::string& name);
+
+#endif //SIMDEVOLVE_H
@@ -0,0 +1,144 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <algorithm>
+#include "../include/SparseLife.h"
+
+std::vector<uint64_t> SparseLife::keys_of(const std::vector<uint8_t>& map, int height, int width) {
+    // Row major order is already the order of the keys
+    std::vector<uint64_t> cells;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            if (map[(size_t)y * width + x] == 1) {
+                cells.push_back(key(x, y));
+            }
+        }
+    }
+    return cells;
+}
+
+void SparseLife::map_of(const std::vector<uint64_t>& keys, std::vector<uint8_t>& map, int height, int width) {
+    std::fill(map.begin(), map.end(), 0);
+    // The keys are sorted by row, so only the rows of the window are visited
+    auto first = std::lower_bound(keys.begin(), keys.end(), key(0, 0));
+    for (auto it = first; it != keys.end() && row(*it) < height; ++it) {
+        int64_t x = column(*it);
+        if (x >= 0 && x < width) {
+            map[(size_t)row(*it) * width + x] = 1;
+        }
+    }
+}
+
+void SparseLife::import_world(const std::vector<uint8_t>& past_map, const std::vector<uint8_t>& present_map, int height, int width) {
+    past = keys_of(past_map, height, width);
+    present = keys_of(present_map, height, width);
+    future.clear();
+}
+
+void SparseLife::export_world(std::vector<uint8_t>& past_map, std::vector<uint8_t>& present_map, int height, int width) const {
+    map_of(past, past_map, height, width);
+    map_of(present, present_map, height, width);
+}
+
+void SparseLife::set_cell(int64_t x, int64_t y, bool alive) {
+    uint64_t k = key(x, y);
+    auto it = std::lower_bound(present.begin(), present.end(), k);
+    bool found = it != present.end() && *it == k;
+    if (alive && !found) {
+        present.insert(it, k);
+    } else if (!alive && found) {
+        present.erase(it);
+    }
+}
+
+bool SparseLife::get_cell(int64_t x, int64_t y) const {
+    return std::binary_search(present.begin(), present.end(), key(x, y));
+}
+
+void SparseLife::add(uint64_t k, uint8_t n) {
+    const size_t mask = keys.size() - 1;
+    size_t slot = (size_t)((k * 0x9E3779B97F4A7C15ULL) >> (64 - table_bits));
+    while (keys[slot] != k) {
+        if (keys[slot] == EMPTY) {
+            keys[slot] = k;
+            counts[slot] = 0;
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    counts[slot] += n;
+}
+
+void SparseLife::evolve() {
+    // At most 9 candidates per live cell, the table is kept at most half full
+    int bits = 6;
+    while (((size_t)1 << bits) < present.size() * 18) {
+        ++bits;
+    }
+    if (bits != table_bits) {
+        table_bits = bits;
+        keys.assign((size_t)1 << bits, EMPTY);
+        counts.assign((size_t)1 << bits, 0);
+    } else {
+        std::fill(keys.begin(), keys.end(), EMPTY);
+    }
+
+    // One unit in x is 1 and one unit in y is 2^32, neighbors are plain additions on the key
+    const uint64_t up = (uint64_t)1 << 32;
+    for (uint64_t k : present) {
+        add(k, 16);
+        add(k - up - 1, 1);
+        add(k - up, 1);
+        add(k - up + 1, 1);
+        add(k - 1, 1);
+        add(k + 1, 1);
+        add(k + up - 1, 1);
+        add(k + up, 1);
+        add(k + up + 1, 1);
+    }
+
+    future.clear();
+    births = deaths = 0;
+    for (size_t slot = 0; slot < keys.size(); ++slot) {
+        if (keys[slot] == EMPTY) {
+            continue;
+        }
+        bool alive = counts[slot] & 16;
+        int n = counts[slot] & 15;
+        bool next = ((alive ? survive_mask : birth_mask) >> n) & 1;
+        if (next) {
+            future.push_back(keys[slot]);
+        }
+        births += next && !alive;
+        deaths += alive && !next;
+    }
+    std::sort(future.begin(), future.end());
+}
+
+bool SparseLife::is_stable() const {
+    return future == present || future == past;
+}
+
+void SparseLife::rotate() {
+    past.swap(present);
+    present.swap(future);
+}
+
+size_t SparseLife::get_memory_usage() const {
+    return (past.capacity() + present.capacity() + future.capacity() + keys.capacity()) * sizeof(uint64_t) + counts.capacity();
+}
+
+bool SparseLife::get_bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1) const {
+    if (present.empty()) {
+        return false;
+    }
+    y0 = row(present.front());
+    y1 = row(present.back());
+    x0 = x1 = column(present.front());
+    for (uint64_t k : present) {
+        x0 = std::min(x0, column(k));
+        x1 = std::max(x1, column(k));
+    }
+    return true;
+}
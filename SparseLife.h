@@ -0,0 +1,58 @@
+#ifndef SPARSELIFE_H
+#define SPARSELIFE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
++ Only the live cells are stored, as a sorted list of 64 bit keys (row in the high half, column in the low
++ half, both biased so the unsigned order is the signed order). A generation adds 1 for every live cell to
++ the 8 neighbors in an open addressing table and marks the cell itself, the cells of the table with the
++ right count are the next generation. Memory and time grow with the population and not with the area.
++ The plane is unbounded (2^32 cells in each direction) and NOT a torus: nothing wraps around, patterns
++ that leave the window are lost when the world is exported back into it.
+*/
+class SparseLife {
+    private:
+        static constexpr uint64_t EMPTY = ~0ULL;
+        static constexpr uint32_t BIAS = 0x80000000u;
+
+        std::vector<uint64_t> past, present, future; // Sorted keys of the live cells
+        std::vector<uint64_t> keys;   // Candidates of the next generation, EMPTY if the slot is free
+        std::vector<uint8_t> counts;  // Live neighbors of the candidate, +16 if the candidate is alive
+        int table_bits = 0;
+        uint32_t birth_mask = 1u << 3, survive_mask = (1u << 2) | (1u << 3);
+        size_t births = 0, deaths = 0;
+
+        static uint64_t key(int64_t x, int64_t y) {
+            return ((uint64_t)((uint32_t)y + BIAS) << 32) | (uint32_t)((uint32_t)x + BIAS);
+        }
+        static int64_t column(uint64_t k) {return (int32_t)((uint32_t)k - BIAS);}
+        static int64_t row(uint64_t k) {return (int32_t)((uint32_t)(k >> 32) - BIAS);}
+        void add(uint64_t k, uint8_t n);
+        static std::vector<uint64_t> keys_of(const std::vector<uint8_t>& map, int height, int width);
+        static void map_of(const std::vector<uint64_t>& keys, std::vector<uint8_t>& map, int height, int width);
+
+    public:
+        SparseLife() = default;
+
+        void set_rule(uint32_t birth, uint32_t survive) {birth_mask = birth; survive_mask = survive;} // Masks of Rule, no B0
+        void import_world(const std::vector<uint8_t>& past, const std::vector<uint8_t>& present, int height, int width); // Cell (0,0) is the origin
+        void export_world(std::vector<uint8_t>& past, std::vector<uint8_t>& present, int height, int width) const; // Only the cells inside the window
+        void set_cell(int64_t x, int64_t y, bool alive);
+        bool get_cell(int64_t x, int64_t y) const;
+
+        void evolve();          // Computes the future from the present
+        bool is_stable() const; // future is the same as the present or the past
+        void rotate();
+
+        size_t get_population() const {return present.size();}
+        size_t get_births() const {return births;} // Of the last evolve()
+        size_t get_deaths() const {return deaths;}
+        size_t get_memory_usage() const;
+        // Bounding box of the live cells, false when there are none
+        bool get_bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1) const;
+};
+
+#endif //SPARSELIFE_H
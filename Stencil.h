@@ -0,0 +1,68 @@
+#ifndef STENCIL_H
+#define STENCIL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <emmintrin.h>
+
+/*
++ B3/S23 for the columns [x0, x1) of one row of the byte per cell world, up/mid/down are the rows above,
++ at and below. Only the columns 0 and width-1 need the toroidal wrap, the rest is read directly.
+*/
+inline void evolve_span(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* out, int width, int x0, int x1) {
+    auto border = [&](int x) {
+        int l = (x + width - 1) % width;
+        int r = (x + 1) % width;
+        int n = up[l] + up[x] + up[r] + mid[l] + mid[r] + down[l] + down[x] + down[r];
+        out[x] = (n == 3) | (mid[x] & (n == 2));
+    };
+
+    int begin = x0, end = x1;
+    if (begin == 0) {
+        border(0);
+        begin = 1;
+    }
+    if (end == width && end > begin) {
+        end = width - 1;
+    }
+    for (int x = begin; x < end; ++x) {
+        int n = up[x - 1] + up[x] + up[x + 1] + mid[x - 1] + mid[x + 1] + down[x - 1] + down[x] + down[x + 1];
+        out[x] = (n == 3) | (mid[x] & (n == 2));
+    }
+    if (x1 == width && width > 1) {
+        border(width - 1);
+    }
+}
+
+/*
++ Adds the cells that became alive (state 1) and the cells that stopped being alive between before and after.
++ The build disables the vectorizer, so this is written with SSE2 (always there on x86-64): 16 cells per
++ compare, the byte counters subtract the -1 masks and are summed with _mm_sad_epu8 every 255 vectors.
+*/
+inline void count_changes(const uint8_t* before, const uint8_t* after, size_t n, size_t& births, size_t& deaths) {
+    const __m128i one = _mm_set1_epi8(1), zero = _mm_setzero_si128();
+    auto sum = [&](__m128i counters) {
+        __m128i s = _mm_sad_epu8(counters, zero);
+        return (size_t)_mm_cvtsi128_si64(s) + (size_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(s, s));
+    };
+
+    const size_t vectors = n / 16;
+    for (size_t first = 0; first < vectors; first += 255) {
+        const size_t last = first + 255 < vectors ? first + 255 : vectors;
+        __m128i b = zero, d = zero;
+        for (size_t k = first; k < last; ++k) {
+            __m128i was = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(before + 16 * k)), one);
+            __m128i is = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(after + 16 * k)), one);
+            b = _mm_sub_epi8(b, _mm_andnot_si128(was, is));
+            d = _mm_sub_epi8(d, _mm_andnot_si128(is, was));
+        }
+        births += sum(b);
+        deaths += sum(d);
+    }
+    for (size_t i = vectors * 16; i < n; ++i) {
+        births += after[i] == 1 && before[i] != 1;
+        deaths += before[i] == 1 && after[i] != 1;
+    }
+}
+
+#endif //STENCIL_H
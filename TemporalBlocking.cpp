@@ -0,0 +1,71 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "../include/TemporalBlocking.h"
+#include "../include/Stencil.h"
+
+namespace {
+
+// Copies the rows [y0 - k, y0 + th + k) and columns [x0 - k, x0 + tw + k) of the torus into buffer
+void gather(const uint8_t* map, int height, int width, int y0, int x0, int th, int tw, int k, uint8_t* buffer) {
+    const int lh = th + 2 * k, lw = tw + 2 * k;
+    const int first = ((x0 - k) % width + width) % width;
+    for (int r = 0; r < lh; ++r) {
+        const uint8_t* row = map + (size_t)(((y0 - k + r) % height + height) % height) * width;
+        uint8_t* out = buffer + (size_t)r * lw;
+        if (x0 - k >= 0 && x0 + tw + k <= width) {
+            std::memcpy(out, row + x0 - k, lw);
+            continue;
+        }
+        // Tiles at the border of the world (or halos wider than the world) wrap around
+        int x = first;
+        for (int c = 0; c < lw; ++c) {
+            out[c] = row[x];
+            if (++x == width) {
+                x = 0;
+            }
+        }
+    }
+}
+
+} // namespace
+
+void advance_blocked(const uint8_t* map, uint8_t* next, int height, int width, int tile, int k) {
+    const int tiles_y = (height + tile - 1) / tile;
+    const int tiles_x = (width + tile - 1) / tile;
+
+    #pragma omp parallel
+    {
+        // One pair of buffers per thread, reused for every tile
+        const size_t side = tile + 2 * k;
+        std::vector<uint8_t> a(side * side), b(side * side);
+
+        #pragma omp for schedule(dynamic)
+        for (int t = 0; t < tiles_y * tiles_x; ++t) {
+            const int y0 = (t / tiles_x) * tile, x0 = (t % tiles_x) * tile;
+            const int th = std::min(tile, height - y0), tw = std::min(tile, width - x0);
+            const int lh = th + 2 * k, lw = tw + 2 * k;
+
+            uint8_t* src = a.data();
+            uint8_t* dst = b.data();
+            gather(map, height, width, y0, x0, th, tw, k, src);
+
+            // Generation s is only known s cells away from the border of the buffer, no wrap is needed
+            for (int s = 1; s <= k; ++s) {
+                for (int y = s; y < lh - s; ++y) {
+                    const uint8_t* mid = src + (size_t)y * lw;
+                    evolve_span(mid - lw, mid, mid + lw, dst + (size_t)y * lw, lw, s, lw - s);
+                }
+                std::swap(src, dst);
+            }
+
+            for (int y = 0; y < th; ++y) {
+                std::memcpy(next + (size_t)(y0 + y) * width + x0, src + (size_t)(y + k) * lw + k, tw);
+            }
+        }
+    }
+}
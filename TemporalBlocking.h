@@ -0,0 +1,15 @@
+#ifndef TEMPORALBLOCKING_H
+#define TEMPORALBLOCKING_H
+
+#include <cstdint>
+
+/*
++ Advances the byte per cell world k generations in one pass over memory. The world is cut into square
++ tiles, every tile is copied together with a k cell halo (toroidal wrap) into a small buffer that fits the
++ cache, advanced k times there (the valid area shrinks by one cell per generation) and only the tile itself
++ is written to next. The world is read and written once per k generations instead of once per generation,
++ at the cost of recomputing the halos: ((tile + 2k) / tile)^2 more cell updates.
+*/
+void advance_blocked(const uint8_t* map, uint8_t* next, int height, int width, int tile, int k);
+
+#endif //TEMPORALBLOCKING_H
@@ -0,0 +1,217 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <algorithm>
+#include <cstring>
+#include "../include/TiledEngine.h"
+#include "../include/Stencil.h"
+
+TiledEngine::TiledEngine(int h, int w, int tile_size, int period_window) : width(w), height(h), tile(tile_size) {
+    tiles_x = (width + tile - 1) / tile;
+    tiles_y = (height + tile - 1) / tile;
+    for (std::vector<uint8_t>& buffer : buffers) {
+        buffer.assign((size_t)width * height, 0);
+    }
+    // Nothing is known in the beginning, so every tile counts as changed
+    changed.assign(tiles_x * tiles_y, 1);
+    changed_prev.assign(tiles_x * tiles_y, 1);
+    changed2.assign(tiles_x * tiles_y, 1);
+    next_changed.assign(tiles_x * tiles_y, 0);
+    next_vs_past.assign(tiles_x * tiles_y, 0);
+    for (std::vector<uint32_t>* counts : {&births, &deaths, &next_births, &next_deaths}) {
+        counts->assign(tiles_x * tiles_y, 0);
+    }
+    for (std::vector<uint64_t>& tile_hashes : hashes) {
+        tile_hashes.assign(tiles_x * tiles_y, 0);
+    }
+    world_hashes.assign(std::max(period_window, 2), 0);
+}
+
+void TiledEngine::load(const std::vector<uint8_t>& past, const std::vector<uint8_t>& present) {
+    head = 0;
+    buffers[0] = present;
+    buffers[1] = past;
+    std::fill(changed.begin(), changed.end(), 1);
+    std::fill(changed_prev.begin(), changed_prev.end(), 1);
+    std::fill(changed2.begin(), changed2.end(), 1);
+
+    // The only full hashing of the world, afterwards the hashes are updated tile by tile
+    for (int k = 0; k < 2; ++k) {
+        for (int t = 0; t < tiles_x * tiles_y; ++t) {
+            hashes[k][t] = hash_tile(buffers[k], t % tiles_x, t / tiles_x);
+        }
+    }
+    ring_head = ring_filled = 0;
+    period = 0;
+    push_hash(hash_world(hashes[0]));
+}
+
+uint64_t TiledEngine::hash_tile(const std::vector<uint8_t>& map, int tx, int ty) const {
+    int x0 = tx * tile, x1 = std::min(width, x0 + tile);
+    int y0 = ty * tile, y1 = std::min(height, y0 + tile);
+    uint64_t h = 0x243F6A8885A308D3ULL;
+    for (int y = y0; y < y1; ++y) {
+        const uint8_t* row = map.data() + (size_t)y * width;
+        int x = x0;
+        for (; x + 8 <= x1; x += 8) {
+            uint64_t word;
+            std::memcpy(&word, row + x, 8);
+            h = (h ^ word) * 0x9E3779B97F4A7C15ULL;
+            h ^= h >> 32;
+        }
+        for (; x < x1; ++x) {
+            h = (h ^ row[x]) * 0x9E3779B97F4A7C15ULL;
+            h ^= h >> 32;
+        }
+    }
+    return h;
+}
+
+uint64_t TiledEngine::hash_world(const std::vector<uint64_t>& tile_hashes) const {
+    // Order independent sum of the mixed tile hashes, the tile index makes moved tiles count as different
+    uint64_t h = 0;
+    for (size_t t = 0; t < tile_hashes.size(); ++t) {
+        uint64_t z = tile_hashes[t] + t * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        h += z ^ (z >> 31);
+    }
+    return h;
+}
+
+void TiledEngine::push_hash(uint64_t hash) {
+    ring_head = (ring_head + 1) % world_hashes.size();
+    world_hashes[ring_head] = hash;
+    ring_filled = std::min(ring_filled + 1, world_hashes.size());
+}
+
+void TiledEngine::store(std::vector<uint8_t>& past, std::vector<uint8_t>& present) const {
+    past = buffers[(head + 1) % 3];
+    present = buffers[head];
+}
+
+bool TiledEngine::any_around(const std::vector<uint8_t>& flags, int tx, int ty) const {
+    for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+            int x = (tx + dx + tiles_x) % tiles_x;
+            int y = (ty + dy + tiles_y) % tiles_y;
+            if (flags[y * tiles_x + x]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void TiledEngine::evolve_tile(int tx, int ty) {
+    const std::vector<uint8_t>& map = buffers[head];
+    const std::vector<uint8_t>& old = buffers[(head + 1) % 3];
+    std::vector<uint8_t>& next = buffers[(head + 2) % 3];
+    int t = ty * tiles_x + tx;
+
+    int x0 = tx * tile, x1 = std::min(width, x0 + tile);
+    int y0 = ty * tile, y1 = std::min(height, y0 + tile);
+    size_t born = 0, died = 0;
+    // Compared row by row right after the row is written, a tile that is skipped on a wrong flag would freeze
+    bool differs = false, differs_past = false;
+    for (int y = y0; y < y1; ++y) {
+        const uint8_t* up = map.data() + (size_t)((y + height - 1) % height) * width;
+        const uint8_t* mid = map.data() + (size_t)y * width;
+        const uint8_t* down = map.data() + (size_t)((y + 1) % height) * width;
+        uint8_t* out = next.data() + (size_t)y * width;
+        evolve_span(up, mid, down, out, width, x0, x1);
+        count_changes(mid + x0, out + x0, x1 - x0, born, died);
+        differs = differs || std::memcmp(mid + x0, out + x0, x1 - x0) != 0;
+        differs_past = differs_past || std::memcmp(old.data() + (size_t)y * width + x0, out + x0, x1 - x0) != 0;
+    }
+    next_births[t] = born;
+    next_deaths[t] = died;
+    next_changed[t] = differs;
+    next_vs_past[t] = differs_past;
+
+    // The tile is still in the cache, hashing it here is cheap. Only the world hash for periods > 2 uses it.
+    hashes[(head + 2) % 3][t] = hash_tile(next, tx, ty);
+}
+
+void TiledEngine::copy_tile(int tx, int ty, const std::vector<uint8_t>& from, std::vector<uint8_t>& to) {
+    int x0 = tx * tile, x1 = std::min(width, x0 + tile);
+    int y0 = ty * tile, y1 = std::min(height, y0 + tile);
+    for (int y = y0; y < y1; ++y) {
+        size_t row = (size_t)y * width;
+        std::copy(from.begin() + row + x0, from.begin() + row + x1, to.begin() + row + x0);
+    }
+}
+
+void TiledEngine::evolve() {
+    int active = 0;
+    int tiles = tiles_x * tiles_y;
+    size_t born = 0, died = 0;
+
+    #pragma omp parallel for schedule(dynamic) reduction(+:active, born, died)
+    for (int t = 0; t < tiles; ++t) {
+        int tx = t % tiles_x, ty = t / tiles_x;
+        if (!any_around(changed, tx, ty)) {
+            /*
+            + The tile did not change from n-1 to n and nothing around it did, so n+1 is the same as n.
+            + The future buffer still holds n-2, which only has to be replaced if the tile changed from n-2 to n-1.
+            */
+            if (changed_prev[t]) {
+                copy_tile(tx, ty, buffers[head], buffers[(head + 2) % 3]);
+            }
+            hashes[(head + 2) % 3][t] = hashes[head][t];
+            next_changed[t] = 0;
+            next_vs_past[t] = 0;
+            next_births[t] = next_deaths[t] = 0;
+        } else if (!any_around(changed2, tx, ty)) {
+            // Everything around the tile is the same as two generations ago, so n+1 is the same as n-1
+            copy_tile(tx, ty, buffers[(head + 1) % 3], buffers[(head + 2) % 3]);
+            hashes[(head + 2) % 3][t] = hashes[(head + 1) % 3][t];
+            next_changed[t] = changed[t];
+            next_vs_past[t] = 0;
+            // Going back to n-1 undoes the changes from n-1 to n
+            next_births[t] = deaths[t];
+            next_deaths[t] = births[t];
+        } else {
+            evolve_tile(tx, ty);
+            active++;
+        }
+        born += next_births[t];
+        died += next_deaths[t];
+    }
+    total_births = born;
+    total_deaths = died;
+    active_fraction = tiles ? (double)active / tiles : 0.0;
+    next_hash = hash_world(hashes[(head + 2) % 3]);
+}
+
+bool TiledEngine::is_stable() {
+    // Period 1 and 2 come directly from the tile flags
+    if (std::none_of(next_changed.begin(), next_changed.end(), [](uint8_t c) { return c; })) {
+        period = 1;
+        return true;
+    }
+    if (std::none_of(next_vs_past.begin(), next_vs_past.end(), [](uint8_t c) { return c; })) {
+        period = 2;
+        return true;
+    }
+    // Longer periods from the ring, the entry p-1 places behind the newest one is generation n+1-p
+    for (size_t p = 3; p <= ring_filled; ++p) {
+        size_t k = (ring_head + world_hashes.size() - (p - 1)) % world_hashes.size();
+        if (world_hashes[k] == next_hash) {
+            period = (int)p;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TiledEngine::rotate() {
+    head = (head + 2) % 3;
+    changed_prev.swap(changed);
+    changed.swap(next_changed);
+    changed2.swap(next_vs_past);
+    births.swap(next_births);
+    deaths.swap(next_deaths);
+    push_hash(next_hash);
+}
@@ -0,0 +1,67 @@
+#ifndef TILEDENGINE_H
+#define TILEDENGINE_H
+
+#include <cstdint>
+#include <vector>
+#include <cstddef>
+
+/*
++ Byte per cell world split into square tiles. A tile is only recomputed when it or one of its 8
++ neighbors changed in the last generation, every other tile is known to stay the same. Tiles around which
++ everything repeats with period 2 (blinkers, toads, beacons) are not computed either, they are copied from n-1.
++ The three generations (past, present, future) rotate by index, so a skipped tile only has to be
++ copied when the buffer it is written to is older than the last change of the tile.
++ The change flags of a computed tile come from comparing its rows with n and n-1 while they are in the cache,
++ so periods 1 and 2 are exact and cost O(tiles) to check. Every tile also has a 64 bit hash that is updated
++ while the tile is computed, the hash of the whole world is combined from them and a ring with the hashes
++ of the last generations detects oscillators with a period > 2.
++ Births and deaths are counted per tile the same way: a copied tile takes them from the generation it copies.
+*/
+class TiledEngine {
+    private:
+        int width = 0, height = 0;
+        int tile = 64;
+        int tiles_x = 0, tiles_y = 0;
+        std::vector<uint8_t> buffers[3];
+        int head = 0; // buffers[head] is the present, (head+1)%3 the past and (head+2)%3 the future
+
+        std::vector<uint8_t> changed;      // Tile changed from n-1 to n
+        std::vector<uint8_t> changed_prev; // Tile changed from n-2 to n-1
+        std::vector<uint8_t> changed2;     // Tile of n differs from n-2
+        std::vector<uint8_t> next_changed; // Tile changed from n to n+1 (filled by evolve())
+        std::vector<uint8_t> next_vs_past; // Tile of n+1 differs from n-1 (filled by evolve())
+        double active_fraction = 0.0;
+        std::vector<uint32_t> births, deaths;           // Per tile, from n-1 to n
+        std::vector<uint32_t> next_births, next_deaths; // Per tile, from n to n+1 (filled by evolve())
+        size_t total_births = 0, total_deaths = 0;
+
+        std::vector<uint64_t> hashes[3];    // Tile hashes of buffers[k]
+        std::vector<uint64_t> world_hashes; // Ring with the hashes of generation n, n-1, ... (newest at ring_head)
+        size_t ring_head = 0, ring_filled = 0;
+        uint64_t next_hash = 0;
+        int period = 0;
+
+        uint64_t hash_tile(const std::vector<uint8_t>& map, int tx, int ty) const;
+        uint64_t hash_world(const std::vector<uint64_t>& tile_hashes) const;
+        void push_hash(uint64_t hash);
+
+        bool any_around(const std::vector<uint8_t>& flags, int tx, int ty) const;
+        void evolve_tile(int tx, int ty);
+        void copy_tile(int tx, int ty, const std::vector<uint8_t>& from, std::vector<uint8_t>& to);
+
+    public:
+        TiledEngine() = default;
+        TiledEngine(int h, int w, int tile_size, int period_window = 60);
+
+        void load(const std::vector<uint8_t>& past, const std::vector<uint8_t>& present);
+        void store(std::vector<uint8_t>& past, std::vector<uint8_t>& present) const;
+        void evolve();        // Computes the future from the present
+        bool is_stable();       // future repeats one of the last period_window generations
+        int get_period() const {return period;} // Period found by the last successful is_stable()
+        void rotate();
+        double get_active_fraction() const {return active_fraction;} // Of the last evolve()
+        size_t get_births() const {return total_births;} // Of the last evolve()
+        size_t get_deaths() const {return total_deaths;}
+};
+
+#endif //TILEDENGINE_H
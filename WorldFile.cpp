@@ -0,0 +1,129 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/WorldFile.h"
+
+static const char MAGIC[4] = {'G', 'O', 'L', 'W'};
+static const uint32_t VERSION = 1;
+
+static size_t payload_size(WorldEncoding encoding, size_t cells) {
+    return encoding == WorldEncoding::BITS ? (cells + 7) / 8 : cells;
+}
+
+bool is_binary_world(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    char magic[4] = {0, 0, 0, 0};
+    bool binary = read(fd, magic, sizeof(magic)) == sizeof(magic) && std::memcmp(magic, MAGIC, sizeof(magic)) == 0;
+    close(fd);
+    return binary;
+}
+
+void read_binary_world(const std::string& path, int& height, int& width, std::vector<uint8_t>& map) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(WorldHeader)) {
+        close(fd);
+        throw std::runtime_error("File is too small to be a binary world: " + path);
+    }
+
+    void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Failed to map file: " + path);
+    }
+    madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+
+    WorldHeader header;
+    std::memcpy(&header, mapping, sizeof(header));
+    WorldEncoding encoding = static_cast<WorldEncoding>(header.encoding);
+    size_t cells = (size_t)header.height * header.width;
+    bool valid = std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION
+              && (encoding == WorldEncoding::BYTES || encoding == WorldEncoding::BITS)
+              && (size_t)info.st_size >= sizeof(WorldHeader) + payload_size(encoding, cells);
+    if (!valid) {
+        munmap(mapping, info.st_size);
+        throw std::runtime_error("Invalid binary world header in file: " + path);
+    }
+
+    height = header.height;
+    width = header.width;
+    map.resize(cells);
+    const uint8_t* payload = static_cast<const uint8_t*>(mapping) + sizeof(WorldHeader);
+    if (encoding == WorldEncoding::BYTES) {
+        std::memcpy(map.data(), payload, cells);
+    } else {
+        #pragma omp parallel for
+        for (long long i = 0; i < (long long)cells; ++i) {
+            map[i] = (payload[i / 8] >> (i % 8)) & 1;
+        }
+    }
+    munmap(mapping, info.st_size);
+}
+
+bool is_two_state(const std::vector<uint8_t>& map) {
+    bool two_states = true;
+    #pragma omp parallel for reduction(&&:two_states)
+    for (long long i = 0; i < (long long)map.size(); ++i) {
+        two_states = two_states && map[i] <= 1;
+    }
+    return two_states;
+}
+
+void write_binary_world(const std::string& path, int height, int width, const std::vector<uint8_t>& map, WorldEncoding encoding) {
+    size_t cells = (size_t)height * width;
+    if (encoding == WorldEncoding::BITS && !is_two_state(map)) {
+        throw std::runtime_error("The world has dying states, which one bit per cell cannot hold: " + path);
+    }
+    size_t size = sizeof(WorldHeader) + payload_size(encoding, cells);
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file for writing.");
+    }
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        throw std::runtime_error("Failed to resize file: " + path);
+    }
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Failed to map file: " + path);
+    }
+
+    WorldHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.encoding = static_cast<uint32_t>(encoding);
+    header.height = height;
+    header.width = width;
+    std::memcpy(mapping, &header, sizeof(header));
+
+    uint8_t* payload = static_cast<uint8_t*>(mapping) + sizeof(WorldHeader);
+    if (encoding == WorldEncoding::BYTES) {
+        std::memcpy(payload, map.data(), cells);
+    } else {
+        // Every thread packs whole bytes, so no two threads write to the same byte
+        #pragma omp parallel for
+        for (long long b = 0; b < (long long)payload_size(encoding, cells); ++b) {
+            uint8_t byte = 0;
+            for (size_t i = b * 8, k = 0; k < 8 && i < cells; ++i, ++k) {
+                byte |= (map[i] != 0) << k;
+            }
+            payload[b] = byte;
+        }
+    }
+    munmap(mapping, size);
+}
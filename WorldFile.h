@@ -0,0 +1,32 @@
+#ifndef WORLDFILE_H
+#define WORLDFILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
++ Binary world format, the file is a 32 byte header followed by the payload:
++   BYTES: one byte (the state) per cell in the same order as the vector (height * width bytes)
++   BITS:  one bit per cell, cell i is bit i % 8 of byte i / 8 (ceil(height * width / 8) bytes), only for
++          worlds of states 0 and 1, the dying states of Generations rules need BYTES
++ All the values are stored little endian. The files are mapped with mmap, so loading and saving is one
++ copy (or pack/unpack) between the mapping and the world, nothing is parsed.
+*/
+enum class WorldEncoding : uint32_t {BYTES = 0, BITS = 1};
+
+struct WorldHeader {
+    char magic[4];         // "GOLW"
+    uint32_t version;      // 1
+    uint32_t encoding;     // WorldEncoding
+    uint32_t height;
+    uint32_t width;
+    uint32_t reserved[3];
+};
+
+bool is_binary_world(const std::string& path); // Checks the magic, text worlds start with the height
+void read_binary_world(const std::string& path, int& height, int& width, std::vector<uint8_t>& map);
+bool is_two_state(const std::vector<uint8_t>& map); // Every cell is 0 or 1, so BITS can hold the world
+void write_binary_world(const std::string& path, int height, int width, const std::vector<uint8_t>& map, WorldEncoding encoding);
+
+#endif //WORLDFILE_H
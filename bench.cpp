@@ -0,0 +1,75 @@
+//
+// Authors: Richard Nicols and Nikola Oljaca
+//
+#include <cstring>
+#include "GameOfLife.h"
+#include "Benchmark.h"
+
+/*
++ Usage: GameOfLifeBenchmark [--engines scalar,fused,...] [--sizes 100,1000] [--densities 0.1,0.5]
++                            [--gens 100] [--warmup 1] [--reps 5] [--seed 42] [--json file] [--csv file]
+*/
+static std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+int main(int argc, char** argv) {
+    BenchmarkConfig config;
+    std::string json, csv;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--engines") {
+            config.engines = split(value);
+        } else if (arg == "--sizes") {
+            config.sizes.clear();
+            for (const std::string& s : split(value)) config.sizes.push_back(std::stoi(s));
+        } else if (arg == "--densities") {
+            config.densities.clear();
+            for (const std::string& s : split(value)) config.densities.push_back(std::stod(s));
+        } else if (arg == "--gens") {
+            config.generations = std::stoi(value);
+        } else if (arg == "--warmup") {
+            config.warmup = std::stoi(value);
+        } else if (arg == "--reps") {
+            config.repetitions = std::stoi(value);
+        } else if (arg == "--seed") {
+            config.seed = std::stoull(value);
+        } else if (arg == "--json") {
+            json = value;
+        } else if (arg == "--csv") {
+            csv = value;
+        } else {
+            std::cerr << "Unknown argument " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<BenchmarkResult> results = run_benchmark(config, std::cerr);
+
+    if (!json.empty()) {
+        std::ofstream file(json);
+        write_benchmark_json(file, config, results);
+    }
+    if (!csv.empty()) {
+        std::ofstream file(csv);
+        write_benchmark_csv(file, results);
+    }
+    if (json.empty() && csv.empty()) {
+        write_benchmark_csv(std::cout, results);
+    }
+    return 0;
+}
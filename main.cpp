@@ -1,7 +1,13 @@
 #include "GameOfLife.h"
+#include "Batch.h"
 #include "CLI.cpp"
 
-int main(){
+int main(int argc, char** argv){
+    // Any argument starts the headless batch runner (see Batch.h), without arguments the menu is used
+    if (argc > 1) {
+        return run_batch(argc, argv);
+    }
+
     int t = 0;
     if (t==1){
         /*
@@ -27,4 +33,4 @@ int main(){
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# Runs the batch CLI with scalar and with another engine on the same seeded world and checks that both end
+# with the same world (cmp of --out) after the same number of generations.
+# Usage: compare_engines.sh <GameOfLife> <engine> <HxW> <gens> [batch options for both runs, e.g. --ranks 7]
+# Exits with 77 (skipped for ctest) when the engine can not run on this machine.
+#
+set -u
+if [ $# -lt 4 ]; then
+    echo "Usage: $0 <GameOfLife> <engine> <HxW> <gens> [batch options]" >&2
+    exit 2
+fi
+binary=$1 engine=$2 size=$3 gens=$4
+shift 4
+
+work=$(mktemp -d) || exit 1
+trap 'rm -rf "$work"' EXIT
+
+run() {
+    name=$1
+    shift
+    "$binary" --size "$size" --density 0.35 --seed 42 --gens "$gens" --engine "$name" "$@" \
+        --out "$work/$name.txt" --stats "$work/$name.json" 2> "$work/$name.log"
+}
+# Only the generations and the stop reason, the timings differ between the runs
+generations() {
+    grep -o '"generations_run": [0-9]*, "generation": [0-9]*, "stable": [a-z]*' "$work/$1.json"
+}
+
+if ! run scalar "$@"; then
+    cat "$work/scalar.log" >&2
+    exit 1
+fi
+if ! run "$engine" "$@"; then
+    cat "$work/$engine.log" >&2
+    # The OpenCL engines need a platform (a GPU driver or a CPU runtime such as POCL)
+    if grep -q "'clGetPlatformIDs'\|'clGetDeviceIDs'" "$work/$engine.log"; then
+        echo "$engine skipped, there is no OpenCL platform" >&2
+        exit 77
+    fi
+    exit 1
+fi
+
+status=0
+if ! cmp -s "$work/scalar.txt" "$work/$engine.txt"; then
+    echo "$engine ended with a different world than scalar ($size, $gens generations $*)" >&2
+    status=1
+fi
+if [ "$(generations scalar)" != "$(generations "$engine")" ]; then
+    echo "$engine: $(generations "$engine"), scalar: $(generations scalar)" >&2
+    status=1
+fi
+[ $status -eq 0 ] && echo "$engine matches scalar: $(generations "$engine")"
+exit $status
@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# Runs hashlife on the same seeded world with the default node cache and with a small --hashlife-memory. The
+# small run has to end with the same world and its cache must not grow past twice the limit on the way.
+# Usage: hashlife_memory.sh <GameOfLife> <HxW> <gens> <MB>
+#
+set -u
+if [ $# -lt 4 ]; then
+    echo "Usage: $0 <GameOfLife> <HxW> <gens> <MB>" >&2
+    exit 2
+fi
+binary=$1 size=$2 gens=$3 limit=$4
+
+work=$(mktemp -d) || exit 1
+trap 'rm -rf "$work"' EXIT
+
+run() {
+    name=$1
+    shift
+    "$binary" --size "$size" --density 0.35 --seed 42 --gens "$gens" --engine hashlife "$@" \
+        --out "$work/$name.txt" --stats "$work/$name.json" 2> "$work/$name.log" || { cat "$work/$name.log" >&2; exit 1; }
+}
+peak() {
+    grep -o '"hashlife_peak_bytes": [0-9]*' "$work/$1.json" | grep -o '[0-9]*$'
+}
+
+run unlimited
+run limited --hashlife-memory "$limit"
+
+status=0
+bound=$((2 * limit * 1024 * 1024))
+if [ "$(peak unlimited)" -le "$bound" ]; then
+    echo "The run only needs $(peak unlimited) bytes, pick a larger world or a smaller limit" >&2
+    status=1
+fi
+if [ "$(peak limited)" -gt "$bound" ]; then
+    echo "hashlife used $(peak limited) bytes with --hashlife-memory $limit" >&2
+    status=1
+fi
+if ! cmp -s "$work/unlimited.txt" "$work/limited.txt"; then
+    echo "hashlife ended with a different world with --hashlife-memory $limit" >&2
+    status=1
+fi
+[ $status -eq 0 ] && echo "hashlife peak $(peak limited) bytes with --hashlife-memory $limit, $(peak unlimited) without"
+exit $status
@@ -0,0 +1,47 @@
+#!/bin/sh
+#
+# Runs a seeded world until it is stable, then runs it again to the generation before, checkpoints it there and
+# resumes it. The resumed run has to stop at the same generation with the same world as the uninterrupted one.
+# Usage: resume_checkpoint.sh <GameOfLife> <engine> <HxW> [batch options for every run, e.g. --seed 7]
+#
+set -u
+if [ $# -lt 3 ]; then
+    echo "Usage: $0 <GameOfLife> <engine> <HxW> [batch options]" >&2
+    exit 2
+fi
+binary=$1 engine=$2 size=$3
+shift 3
+
+work=$(mktemp -d) || exit 1
+trap 'rm -rf "$work"' EXIT
+
+run() {
+    name=$1 gens=$2
+    shift 2
+    "$binary" --size "$size" --density 0.35 --seed 42 --engine "$engine" "$@" --gens "$gens" \
+        --out "$work/$name.txt" --stats "$work/$name.json" 2> "$work/$name.log" || { cat "$work/$name.log" >&2; exit 1; }
+}
+generation() {
+    grep -o '"generation": [0-9]*' "$work/$1.json" | grep -o '[0-9]*$'
+}
+
+run full 5000 "$@"
+if ! grep -q '"stable": true' "$work/full.json"; then
+    echo "The world is not stable after 5000 generations, pick another seed" >&2
+    exit 1
+fi
+stop=$(generation full)
+run before $((stop - 1)) "$@" --checkpoint "$work/checkpoint" --checkpoint-every 1000000
+run resumed 5000 "$@" --resume "$work/checkpoint"
+
+status=0
+if [ "$(generation resumed)" != "$stop" ]; then
+    echo "$engine: resumed at $((stop - 1)) stopped at $(generation resumed), uninterrupted at $stop" >&2
+    status=1
+fi
+if ! cmp -s "$work/full.txt" "$work/resumed.txt"; then
+    echo "$engine: the resumed run ended with a different world" >&2
+    status=1
+fi
+[ $status -eq 0 ] && echo "$engine resumed at $((stop - 1)) stops at $stop"
+exit $status